@@ -13,37 +13,162 @@
 #include <errno.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <ctype.h>
 #include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "stack_op.h"
 #include "poly.h"
 #include "parse.h"
+#include "pipe.h"
 
 /**
  * Znacznik komentarza. */
 #define COMMENT_MARKER '#'
 
+/**
+ * Co ile bajtów odwzorowanego wejścia oddajemy systemowi przetworzone strony. */
+#define MAP_RELEASE_STEP (1 << 24)
+
+/**
+ * Rozmiar kawałków, w jakich strumieniowo wczytujemy linie z wielomianami. */
+#define POLY_CHUNK_SIZE 4096
+
 static void Interpret(struct Stack*, bool prettification);
 
+static void InterpretPipelined(struct Stack* stack);
+
 /**
  * Główna procedura programu, włącza właściwy interpreter i inicjalizuje stos
- * kalkulatora. Przyjmuje argumenty z linii poleceń: jeśli jest nim `-p` bądź
- * `--pretty` to będzie wypisywać dodatkowo lekkie uładnienia dla użytkownika.
+ * kalkulatora. Przyjmuje argumenty z linii poleceń: jeśli jest wśród nich `-p`
+ * bądź `--pretty` to będzie wypisywać dodatkowo lekkie uładnienia dla
+ * użytkownika, `--file plik` każe czytać komendy z pliku zamiast ze
+ * standardowego wejścia, `--restore plik` zaczyna pracę od stosu zapisanego
+ * komendą `CHECKPOINT`, `--pipeline` czyta i parsuje wejście w osobnym
+ * wątku, równolegle z wykonywaniem komend, `--lazy` odkłada obliczanie
+ * sum, różnic i negacji do chwili, gdy wynik jest potrzebny, `--jobs n`
+ * pozwala liczyć naraz do `n` niezależnych komend `MUL`, `COMPOSE` i `AT`, a
+ * `--peephole` włącza optymalizator ciągów komend; `--peephole-stats` robi to
+ * samo i na koniec wypisuje, ile razy zadziałały jego reguły. `--memo`
+ * zapamiętuje wyniki `MUL`, `COMPOSE` i `AT` w pamięci wyników o rozmiarze
+ * @ref MEMO_DEFAULT_CAP, `--memo-cap n` -- o rozmiarze `n` MiB, a
+ * `--memo-stats` na koniec wypisuje jej trafienia i chybienia.
+ * `--fingerprints` każe wielomianom na stosie nosić odciski, dzięki którym
+ * `IS_EQ` rozstrzyga większość nierówności bez porównywania, a
+ * `--tuning plik` wczytuje profil progów wyboru algorytmów zapisany przez
+ * `poly_tune`.
  */
 int main(int argc, char* argv[])
 {
   struct Stack stack = EmptyStack();
+  bool prettification = false;
+  bool pipeline = false;
+  bool peephole = false;
+  bool stats = false;
+  bool memo = false;
+  bool memo_stats = false;
+  size_t memo_cap = MEMO_DEFAULT_CAP;
+  PolyTuning tuning;
+  unsigned long mib;
+  char* end;
+  int fd;
 
-  if (argc >= 2 && (strcmp(argv[1], "-p") == 0 ||
-                    strcmp(argv[1], "--pretty") == 0)) {
-    printf("---< Poly Calc >-----------< v. 1.0 >----\n");
-    Interpret(&stack, true);
-  } else {
-    Interpret(&stack, false);
+  for (int i = 1; i < argc; ++i) {
+    if (strcmp(argv[i], "-p") == 0 || strcmp(argv[i], "--pretty") == 0) {
+      prettification = true;
+    } else if (strcmp(argv[i], "--pipeline") == 0) {
+      pipeline = true;
+    } else if (strcmp(argv[i], "--peephole") == 0) {
+      peephole = true;
+    } else if (strcmp(argv[i], "--peephole-stats") == 0) {
+      peephole = stats = true;
+    } else if (strcmp(argv[i], "--fingerprints") == 0) {
+      stack.fingerprint_mode = true;
+    } else if (strcmp(argv[i], "--memo") == 0) {
+      memo = true;
+    } else if (strcmp(argv[i], "--memo-stats") == 0) {
+      memo = memo_stats = true;
+    } else if (strcmp(argv[i], "--memo-cap") == 0 && i + 1 < argc) {
+      errno = 0;
+      mib = strtoul(argv[++i], &end, 10);
+
+      if (errno || *end != '\0' || !isdigit(*argv[i]) ||
+          mib > SIZE_MAX >> 20) {
+        fprintf(stderr, "%s: wrong memo cap\n", argv[i]);
+        StackDestroy(&stack);
+        return 1;
+      }
+
+      memo = true;
+      memo_cap = (size_t)mib << 20;
+    } else if (strcmp(argv[i], "--lazy") == 0) {
+      stack.lazy_mode = true;
+    } else if (strcmp(argv[i], "--jobs") == 0 && i + 1 < argc) {
+      errno = 0;
+      stack.jobs = strtoul(argv[++i], &end, 10);
+
+      if (errno || *end != '\0' || !isdigit(*argv[i]) || stack.jobs < 1) {
+        fprintf(stderr, "%s: wrong number of jobs\n", argv[i]);
+        StackDestroy(&stack);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc) {
+      fd = open(argv[++i], O_RDONLY);
+
+      if (fd < 0 || dup2(fd, STDIN_FILENO) < 0) {
+        perror(argv[i]);
+        return 1;
+      }
+
+      close(fd);
+    } else if (strcmp(argv[i], "--tuning") == 0 && i + 1 < argc) {
+      if (!PolyTuningLoad(argv[++i], &tuning)) {
+        fprintf(stderr, "%s: wrong tuning profile\n", argv[i]);
+        StackDestroy(&stack);
+        return 1;
+      }
+
+      PolyTuningSet(&tuning);
+    } else if (strcmp(argv[i], "--restore") == 0 && i + 1 < argc) {
+      if (!Restore(&stack, argv[++i])) {
+        fprintf(stderr, "%s: wrong checkpoint\n", argv[i]);
+        StackDestroy(&stack);
+        return 1;
+      }
+    }
   }
 
+  if (prettification)
+    printf("---< Poly Calc >-----------< v. 1.0 >----\n");
+
+  /* w trybie interaktywnym nie ma czego wczytywać z wyprzedzeniem ani na co
+   * czekać z wykonaniem komendy */
+  if (peephole && !prettification)
+    PeepholeEnable();
+
+  if (memo)
+    stack.memo = MemoNew(memo_cap);
+
+  if (pipeline && !prettification)
+    InterpretPipelined(&stack);
+  else
+    Interpret(&stack, prettification);
+
+  PeepholeFlush(&stack);
+
+  if (stats)
+    PeepholeReport();
+
+  if (memo_stats)
+    MemoReport(stack.memo);
+
   StackDestroy(&stack);
+  MemoDestroy(stack.memo);
   return 0;
 }
 
@@ -71,10 +196,179 @@ static bool IsEmpty(char* line, size_t len)
 
 static void UpperLine(char* s, size_t len);
 
+/**
+ * Wykonanie pojedynczej niekomentarzowej linii zakończonej znakiem '`\0`'.
+ * @param[in] stack : stos kalkulatora
+ * @param[in,out] line : linia
+ * @param[in] len : długość linii
+ * @param[in] linum : numer linii
+ * @param[in] prettification : czy zamieniać litery na wielkie
+ */
+static void InterpretLine(struct Stack* stack, char* line, size_t len,
+                          size_t linum, bool prettification)
+{
+  if (IsEmpty(line, len))
+    return;
+
+  if (prettification)
+    UpperLine(line, len);
+
+  ParseLine(line, len, linum, stack);
+}
+
+/**
+ * Odwzorowanie standardowego wejścia w pamięci, o ile jest ono zwykłym
+ * niepustym plikiem. Odwzorowanie jest prywatne, więc można po nim pisać bez
+ * zmieniania pliku.
+ * @param[out] size : rozmiar odwzorowania
+ * @param[out] pos : bieżąca pozycja wejścia w pliku
+ * @return początek odwzorowania bądź `NULL`, jeśli się nie da
+ */
+static char* MapStdin(size_t* size, size_t* pos)
+{
+  struct stat st;
+  off_t off;
+  char* buf;
+
+  if (fstat(STDIN_FILENO, &st) != 0 || !S_ISREG(st.st_mode))
+    return NULL;
+
+  off = lseek(STDIN_FILENO, 0, SEEK_CUR);
+
+  if (off < 0 || off >= st.st_size)
+    return NULL;
+
+  buf = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+             STDIN_FILENO, 0);
+
+  if (buf == MAP_FAILED)
+    return NULL;
+
+  *size = st.st_size;
+  *pos = off;
+  return buf;
+}
+
+/**
+ * Czytanie komend z odwzorowanego w pamięci wejścia. Linie wyznaczamy
+ * `memchr`em i wykonujemy w miejscu -- na czas wykonania znak za linią
+ * zastępujemy '`\0`'. Numeracja linii i pseudo prompt są takie same jak przy
+ * czytaniu strumieniowym.
+ * @param[in] stack : stos kalkulatora
+ * @param[in] prettification : jeśli jest `true` to dodaje pseudo prompt
+ * @param[in,out] buf : odwzorowane wejście
+ * @param[in] size : rozmiar wejścia
+ * @param[in] pos : pozycja, od której zaczynamy czytać
+ */
+static void InterpretMapped(struct Stack* stack, bool prettification,
+                            char* buf, size_t size, size_t pos)
+{
+  size_t page = sysconf(_SC_PAGESIZE);
+  size_t released = 0;
+  size_t linum = 1;
+  size_t len;
+  char* line;
+  char* nl;
+  char* tail;
+  char saved;
+
+  for (;;) {
+    if (prettification)
+      printf("|%lu|> ", linum);
+
+    if (pos == size)
+      break;
+
+    line = buf + pos;
+    nl = memchr(line, '\n', size - pos);
+    len = nl ? (size_t)(nl - line) + 1 : size - pos;
+
+    if (*line != COMMENT_MARKER) {
+      if (pos + len < size) {
+        saved = line[len];
+        line[len] = '\0';
+        InterpretLine(stack, line, len, linum, prettification);
+        line[len] = saved;
+      } else if (size % page) {
+        /* reszta ostatniej strony odwzorowania jest wyzerowana */
+        InterpretLine(stack, line, len, linum, prettification);
+      } else {
+        tail = malloc(len + 1);
+
+        if (!tail)
+          exit(1);
+
+        memcpy(tail, line, len);
+        tail[len] = '\0';
+        InterpretLine(stack, tail, len, linum, prettification);
+        free(tail);
+      }
+    }
+
+    pos += len;
+    ++linum;
+
+    if (!nl)
+      break;
+
+    /* zapisane strony są prywatnymi kopiami -- po przeczytaniu je oddajemy */
+    if (pos - released >= MAP_RELEASE_STEP) {
+      madvise(buf + released, pos / page * page - released, MADV_DONTNEED);
+      released = pos / page * page;
+    }
+  }
+
+  munmap(buf, size);
+}
+
+/**
+ * Wczytanie ze standardowego wejścia linii z wielomianem kawałkami stałej
+ * długości. Kawałki trafiają od razu do parsera, więc nawet bardzo długa linia
+ * nie musi mieścić się w pamięci obok budowanego z niej wielomianu.
+ * @param[out] p : wczytany wielomian, jeśli linia była poprawna
+ * @return czy linia była poprawnym wielomianem
+ */
+static bool ReadPoly(Poly* p)
+{
+  char chunk[POLY_CHUNK_SIZE];
+  struct PolyParser pp;
+  size_t n;
+  int c = 0;
+
+  PolyParserInit(&pp);
+
+  while (c != '\n' && c != EOF) {
+    for (n = 0; n < POLY_CHUNK_SIZE && (c = getc_unlocked(stdin)) != EOF;) {
+      chunk[n++] = c;
+
+      if (c == '\n')
+        break;
+    }
+
+    PolyParserFeed(&pp, chunk, n);
+  }
+
+  return PolyParserTake(&pp, p);
+}
+
+/**
+ * Wczytanie linii z wielomianem przez @ref ReadPoly i odłożenie go na stos.
+ * @param[in] stack : stos kalkulatora
+ * @param[in] linum : numer linii
+ */
+static void InterpretPoly(struct Stack* stack, size_t linum)
+{
+  Poly p;
+  bool correct = ReadPoly(&p);
+
+  PushParsedPoly(stack, &p, correct, linum);
+}
+
 static ssize_t ReadLine(char** ptr, size_t* size, bool* is_eof,
-                        bool* is_comment);
+                        bool* is_comment, bool* is_poly);
 /**
- * Czytanie komend ze standardowego wejścia.
+ * Czytanie komend ze standardowego wejścia. Jeśli wejście jest zwykłym plikiem,
+ * czytamy je przez @ref InterpretMapped.
  * @param[in] stack : stos kalkulatora
  * @param[in] prettification : jeśli jest `true` to dodaje pseudo prompt
  */
@@ -85,20 +379,26 @@ static void Interpret(struct Stack* stack, bool prettification)
   size_t size = 0;
   char* line = NULL;
   bool is_comment = false;
+  bool is_poly = false;
   bool is_eof = false;
+  size_t pos;
+  char* buf;
+
+  if ((buf = MapStdin(&size, &pos))) {
+    InterpretMapped(stack, prettification, buf, size, pos);
+    return;
+  }
 
   while (!feof(stdin) && !is_eof) {
     if (prettification)
       printf("|%lu|> ", linum);
 
-    len = ReadLine(&line, &size, &is_eof, &is_comment);
+    len = ReadLine(&line, &size, &is_eof, &is_comment, &is_poly);
 
-    if (!is_comment && !is_eof && !IsEmpty(line, len)) {
-      if (prettification)
-        UpperLine(line, len);
-
-      ParseLine(line, len, linum, stack);
-    }
+    if (is_poly)
+      InterpretPoly(stack, linum);
+    else if (!is_comment && !is_eof)
+      InterpretLine(stack, line, len, linum, prettification);
 
     ++linum;
   }
@@ -106,22 +406,107 @@ static void Interpret(struct Stack* stack, bool prettification)
   free(line);
 }
 
+/**
+ * Wątek czytający wejście potoku: wczytuje linie, od razu parsuje wielomiany i
+ * przekazuje wszystko w kolejności do wątku wykonującego. Linie komentarzowe
+ * i puste pomija, zachowując ich numerację.
+ * @param[in,out] arg : kolejka do wątku wykonującego
+ * @return `NULL`
+ */
+static void* ReadStage(void* arg)
+{
+  struct Pipe* pipe = arg;
+  struct PipeItem item;
+  ssize_t len;
+  size_t linum = 1;
+  size_t size = 0;
+  char* line = NULL;
+  bool is_comment = false;
+  bool is_poly = false;
+  bool is_eof = false;
+
+  while (!feof(stdin) && !is_eof) {
+    len = ReadLine(&line, &size, &is_eof, &is_comment, &is_poly);
+    item.linum = linum++;
+
+    if (is_poly) {
+      item.kind = PIPE_POLY;
+      item.correct = ReadPoly(&item.p);
+      PipePush(pipe, &item);
+    } else if (!is_comment && !is_eof && !IsEmpty(line, len)) {
+      /* linia przechodzi na własność wątku wykonującego */
+      item.kind = PIPE_LINE;
+      item.line = line;
+      item.len = len;
+      PipePush(pipe, &item);
+      line = NULL;
+      size = 0;
+    }
+  }
+
+  item.kind = PIPE_END;
+  PipePush(pipe, &item);
+  free(line);
+  return NULL;
+}
+
+/**
+ * Czytanie komend ze standardowego wejścia potokiem dwóch wątków. Wątek
+ * @ref ReadStage wczytuje i parsuje linie, a bieżący wykonuje je w tej samej
+ * kolejności, więc wyjście i komunikaty błędów są takie jak przy
+ * @ref Interpret. Gdy wątku nie da się utworzyć, czytamy zwyczajnie.
+ * @param[in] stack : stos kalkulatora
+ */
+static void InterpretPipelined(struct Stack* stack)
+{
+  struct Pipe* pipe = malloc(sizeof(struct Pipe));
+  struct PipeItem item;
+  pthread_t reader;
+
+  if (!pipe)
+    exit(1);
+
+  PipeInit(pipe);
+
+  if (pthread_create(&reader, NULL, ReadStage, pipe) != 0) {
+    free(pipe);
+    Interpret(stack, false);
+    return;
+  }
+
+  for (PipePop(pipe, &item); item.kind != PIPE_END; PipePop(pipe, &item)) {
+    if (item.kind == PIPE_POLY) {
+      PushParsedPoly(stack, &item.p, item.correct, item.linum);
+    } else {
+      ParseLine(item.line, item.len, item.linum, stack);
+      free(item.line);
+    }
+  }
+
+  pthread_join(reader, NULL);
+  free(pipe);
+}
+
 /**
  * Wczytywanie pojedynczych linii ze standardowego wejścia.
  * @param[in,out] ptr : bufor do zapisywania linii
  * @param[in,out] size : wielkość bufora
  * @param[out] is_eof : czy nie skończyło się wejście
  * @param[out] is_comment : czy to nie linijka komentarzowa
+ * @param[out] is_poly : czy to linijka z wielomianem -- takiej nie wczytujemy,
+ * zostawiamy ją dla @ref InterpretPoly
  * @return długość wczytanej linii
  */
 static ssize_t ReadLine(char** ptr, size_t* size, bool* is_eof,
-                        bool* is_comment)
+                        bool* is_comment, bool* is_poly)
 {
   ssize_t len;
   /* za pomocą c wysonduję czy to nie jest linia komentarna pierwiej niźli ją
    * wczytam getline'em */
   int c = getc(stdin);
 
+  *is_poly = false;
+
   if (c == EOF) {
     *is_eof = true;
     return EOF;
@@ -136,6 +521,10 @@ static ssize_t ReadLine(char** ptr, size_t* size, bool* is_eof,
   }
 
   ungetc(c, stdin);
+
+  if ((*is_poly = !isalpha(c) && c != '\n'))
+    return 0;
+
   len = getline(ptr, size, stdin);
   *is_eof = len == EOF;
 
@@ -146,9 +535,10 @@ static ssize_t ReadLine(char** ptr, size_t* size, bool* is_eof,
 }
 
 /**
- * Zmienia litery na wielkie w linijce @p s długości @p len. */
+ * Zmienia litery na wielkie w nazwie komendy z linijki @p s długości @p len.
+ * Argument zostaje nietknięty, bo może być nazwą pliku. */
 static void UpperLine(char* s, size_t len)
 {
-  for (size_t i = 0; i < len; ++i)
+  for (size_t i = 0; i < len && !isspace(s[i]); ++i)
     s[i] = toupper(s[i]);
 }
@@ -0,0 +1,274 @@
+/** @file
+  Implementacja pamięci wyników z pliku memo.h.
+
+  @author Grzegorz Cichosz <g.cichosz@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date czerwiec 2021
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "poly.h"
+#include "poly_lib.h"
+#include "memo.h"
+
+/**
+ * Początkowa liczba kubełków; potęga dwójki. */
+#define MEMO_INIT_BUCKETS 64
+
+struct Memo* MemoNew(size_t cap)
+{
+  struct Memo* memo = calloc(1, sizeof(struct Memo));
+
+  if (!memo)
+    exit(1);
+
+  memo->buckets = calloc(MEMO_INIT_BUCKETS, sizeof(struct MemoEntry*));
+
+  if (!memo->buckets)
+    exit(1);
+
+  memo->bucket_count = MEMO_INIT_BUCKETS;
+  memo->cap = cap;
+  return memo;
+}
+
+/**
+ * Usunięcie wyniku wraz z kluczem. Nie odpina go od list.
+ * @param[in] e : wynik
+ */
+static void MemoEntryDestroy(struct MemoEntry* e)
+{
+  for (size_t i = 0; i < e->key.count; ++i)
+    PolyDestroy(e->key.args + i);
+
+  free(e->key.args);
+  PolyDestroy(&e->result);
+  free(e);
+}
+
+void MemoDestroy(struct Memo* memo)
+{
+  struct MemoEntry* older;
+
+  if (!memo)
+    return;
+
+  for (struct MemoEntry* e = memo->newest; e; e = older) {
+    older = e->older;
+    MemoEntryDestroy(e);
+  }
+
+  free(memo->buckets);
+  free(memo);
+}
+
+void MemoKeyInit(struct MemoKey* key, enum MemoOp op, poly_coeff_t arg,
+                 size_t count, Poly args[])
+{
+  key->op = op;
+  key->arg = arg;
+  key->count = count;
+  key->args = args;
+  key->hash = ((uint64_t)op << 56) ^ (uint64_t)arg;
+
+  for (size_t i = 0; i < count; ++i)
+    key->hash = key->hash * 0x100000001b3ULL ^ PolyHash(args + i);
+}
+
+/**
+ * Porównanie kluczy -- najpierw skrótów, a dopiero przy ich równości
+ * argumentów.
+ * @param[in] k : klucz
+ * @param[in] l : klucz
+ * @return czy klucze są równe
+ */
+static bool MemoKeyIsEq(const struct MemoKey* k, const struct MemoKey* l)
+{
+  if (k->hash != l->hash || k->op != l->op || k->arg != l->arg ||
+      k->count != l->count)
+    return false;
+
+  for (size_t i = 0; i < k->count; ++i) {
+    if (!PolyIsEq(k->args + i, l->args + i))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * Kubełek klucza o skrócie @p hash.
+ * @param[in] memo : pamięć wyników
+ * @param[in] hash : skrót
+ * @return wskaźnik na początek listy kubełka
+ */
+static struct MemoEntry** MemoBucket(const struct Memo* memo, uint64_t hash)
+{
+  return memo->buckets + (hash & (memo->bucket_count - 1));
+}
+
+/**
+ * Odpięcie wyniku z listy od ostatnio do najdawniej użytego.
+ * @param[in,out] memo : pamięć wyników
+ * @param[in,out] e : wynik
+ */
+static void MemoUnlink(struct Memo* memo, struct MemoEntry* e)
+{
+  if (e->newer)
+    e->newer->older = e->older;
+  else
+    memo->newest = e->older;
+
+  if (e->older)
+    e->older->newer = e->newer;
+  else
+    memo->oldest = e->newer;
+}
+
+/**
+ * Wpięcie wyniku na początek listy jako ostatnio użytego.
+ * @param[in,out] memo : pamięć wyników
+ * @param[in,out] e : wynik
+ */
+static void MemoLinkNewest(struct Memo* memo, struct MemoEntry* e)
+{
+  e->newer = NULL;
+  e->older = memo->newest;
+
+  if (memo->newest)
+    memo->newest->newer = e;
+  else
+    memo->oldest = e;
+
+  memo->newest = e;
+}
+
+bool MemoFind(struct Memo* memo, const struct MemoKey* key, Poly* result)
+{
+  struct MemoEntry* e = *MemoBucket(memo, key->hash);
+
+  while (e && !MemoKeyIsEq(&e->key, key))
+    e = e->chain;
+
+  if (!e) {
+    ++memo->misses;
+    return false;
+  }
+
+  ++memo->hits;
+  MemoUnlink(memo, e);
+  MemoLinkNewest(memo, e);
+  *result = PolyClone(&e->result);
+  return true;
+}
+
+/**
+ * Wyrzucenie najdawniej użytego wyniku.
+ * @param[in,out] memo : niepusta pamięć wyników
+ */
+static void MemoEvict(struct Memo* memo)
+{
+  struct MemoEntry* e = memo->oldest;
+  struct MemoEntry** tracer = MemoBucket(memo, e->key.hash);
+
+  while (*tracer != e)
+    tracer = &(*tracer)->chain;
+
+  *tracer = e->chain;
+  MemoUnlink(memo, e);
+  memo->bytes -= e->bytes;
+  --memo->count;
+  ++memo->evictions;
+  MemoEntryDestroy(e);
+}
+
+/**
+ * Podwojenie liczby kubełków i rozłożenie w nich wyników na nowo.
+ * @param[in,out] memo : pamięć wyników
+ */
+static void MemoGrow(struct Memo* memo)
+{
+  struct MemoEntry** old = memo->buckets;
+  size_t old_count = memo->bucket_count;
+  struct MemoEntry** bucket;
+  struct MemoEntry* chain;
+
+  memo->buckets = calloc(2 * old_count, sizeof(struct MemoEntry*));
+
+  if (!memo->buckets)
+    exit(1);
+
+  memo->bucket_count = 2 * old_count;
+
+  for (size_t i = 0; i < old_count; ++i) {
+    for (struct MemoEntry* e = old[i]; e; e = chain) {
+      chain = e->chain;
+      bucket = MemoBucket(memo, e->key.hash);
+      e->chain = *bucket;
+      *bucket = e;
+    }
+  }
+
+  free(old);
+}
+
+void MemoInsert(struct Memo* memo, struct MemoKey* key, const Poly* result)
+{
+  size_t bytes = sizeof(struct MemoEntry) + key->count * sizeof(Poly) +
+                 PolySize(result) * sizeof(MonoList);
+  struct MemoEntry** bucket;
+  struct MemoEntry* e;
+
+  for (size_t i = 0; i < key->count; ++i)
+    bytes += PolySize(key->args + i) * sizeof(MonoList);
+
+  if (bytes > memo->cap) {
+    for (size_t i = 0; i < key->count; ++i) {
+      PolyDestroy(key->args + i);
+      key->args[i] = PolyZero();
+    }
+
+    return;
+  }
+
+  while (memo->bytes + bytes > memo->cap)
+    MemoEvict(memo);
+
+  e = malloc(sizeof(struct MemoEntry));
+
+  if (!e)
+    exit(1);
+
+  e->key = *key;
+  e->key.args = malloc(key->count * sizeof(Poly));
+
+  if (!e->key.args)
+    exit(1);
+
+  for (size_t i = 0; i < key->count; ++i) {
+    e->key.args[i] = key->args[i];
+    key->args[i] = PolyZero();
+  }
+
+  e->result = PolyClone(result);
+  e->bytes = bytes;
+
+  if (memo->count == memo->bucket_count)
+    MemoGrow(memo);
+
+  bucket = MemoBucket(memo, e->key.hash);
+  e->chain = *bucket;
+  *bucket = e;
+  MemoLinkNewest(memo, e);
+  memo->bytes += bytes;
+  ++memo->count;
+}
+
+void MemoReport(const struct Memo* memo)
+{
+  fprintf(stderr, "memo: hits %zu, misses %zu, evictions %zu, entries %zu, "
+          "bytes %zu\n", memo->hits, memo->misses, memo->evictions,
+          memo->count, memo->bytes);
+}
@@ -0,0 +1,122 @@
+/** @file
+  Pamięć wyników kalkulatora. Skrypty często liczą wiele razy `MUL`,
+  `COMPOSE` czy `AT` na takich samych wielomianach; wynik raz policzony
+  zapamiętujemy pod kluczem złożonym z komendy, jej parametru i skrótów
+  argumentów. Pamięć ma ograniczony rozmiar, a przy jego przekroczeniu
+  wyrzucane są wyniki najdawniej użyte.
+
+  @author Grzegorz Cichosz <g.cichosz@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date czerwiec 2021
+*/
+
+#ifndef _MEMO_H_
+#define _MEMO_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "poly.h"
+
+/**
+ * Domyślny rozmiar pamięci wyników w bajtach. */
+#define MEMO_DEFAULT_CAP ((size_t)64 << 20)
+
+/**
+ * Komenda, której wyniki zapamiętujemy. */
+enum MemoOp {
+  MEMO_MUL,                     /**< `MUL` */
+  MEMO_COMPOSE,                 /**< `COMPOSE k` */
+  MEMO_AT                       /**< `AT x` */
+};
+
+/**
+ * Klucz wyniku: komenda z parametrem i jej argumenty w kolejności od dna
+ * stosu. */
+struct MemoKey {
+  enum MemoOp op;               /**< komenda */
+  poly_coeff_t arg;             /**< parametr `COMPOSE` bądź `AT` */
+  size_t count;                 /**< liczba argumentów */
+  Poly* args;                   /**< argumenty */
+  uint64_t hash;                /**< skrót całego klucza */
+};
+
+/**
+ * Zapamiętany wynik. Leży naraz na liście kubełka i na liście od ostatnio do
+ * najdawniej użytego. */
+struct MemoEntry {
+  struct MemoKey key;           /**< klucz, z własnymi argumentami */
+  Poly result;                  /**< wynik */
+  size_t bytes;                 /**< zajmowana pamięć */
+  struct MemoEntry* chain;      /**< następny w kubełku */
+  struct MemoEntry* newer;      /**< użyty później */
+  struct MemoEntry* older;      /**< użyty wcześniej */
+};
+
+/**
+ * Pamięć wyników: tablica z haszowaniem, kubełki jako listy. */
+struct Memo {
+  struct MemoEntry** buckets;   /**< kubełki */
+  size_t bucket_count;          /**< liczba kubełków; potęga dwójki */
+  size_t count;                 /**< liczba wyników */
+  struct MemoEntry* newest;     /**< ostatnio użyty */
+  struct MemoEntry* oldest;     /**< najdawniej użyty */
+  size_t bytes;                 /**< zajmowana pamięć */
+  size_t cap;                   /**< największa dopuszczalna pamięć */
+  size_t hits;                  /**< liczba trafień */
+  size_t misses;                /**< liczba chybień */
+  size_t evictions;             /**< liczba wyrzuconych wyników */
+};
+
+/**
+ * Utworzenie pustej pamięci wyników.
+ * @param[in] cap : największa pamięć w bajtach, jaką może zająć
+ * @return pamięć wyników
+ */
+struct Memo* MemoNew(size_t cap);
+
+/**
+ * Usunięcie pamięci wyników wraz z wynikami.
+ * @param[in] memo : pamięć wyników bądź `NULL`
+ */
+void MemoDestroy(struct Memo* memo);
+
+/**
+ * Przygotowanie klucza i policzenie jego skrótu.
+ * @param[out] key : klucz
+ * @param[in] op : komenda
+ * @param[in] arg : jej parametr, dla `MUL` zero
+ * @param[in] count : liczba argumentów
+ * @param[in] args : argumenty
+ */
+void MemoKeyInit(struct MemoKey* key, enum MemoOp op, poly_coeff_t arg,
+                 size_t count, Poly args[]);
+
+/**
+ * Szukanie wyniku dla klucza. Znaleziony staje się ostatnio użytym.
+ * @param[in,out] memo : pamięć wyników
+ * @param[in] key : klucz
+ * @param[out] result : kopia wyniku, jeśli jest
+ * @return czy wynik był zapamiętany
+ */
+bool MemoFind(struct Memo* memo, const struct MemoKey* key, Poly* result);
+
+/**
+ * Zapamiętanie wyniku. Argumenty klucza przechodzą na własność pamięci
+ * wyników (zostają w nich zera), a wynik jest kopiowany. Wynik większy niż
+ * cała pamięć nie jest zapamiętywany.
+ * @param[in,out] memo : pamięć wyników
+ * @param[in,out] key : klucz z @ref MemoKeyInit, nieznaleziony
+ * @param[in] result : wynik
+ */
+void MemoInsert(struct Memo* memo, struct MemoKey* key, const Poly* result);
+
+/**
+ * Wypisanie na standardowe wyjście błędów liczby trafień, chybień i
+ * wyrzuconych wyników oraz zajmowanej pamięci.
+ * @param[in] memo : pamięć wyników
+ */
+void MemoReport(const struct Memo* memo);
+
+#endif  /* _MEMO_H_ */
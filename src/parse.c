@@ -13,6 +13,10 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <pthread.h>
 
 #include "poly.h"
 #include "poly_lib.h"
@@ -33,146 +37,351 @@
 /** Maksymalna dopuszczalna wartość wykładnika wielomianu. */
 #define EXP_MAX 2147483647
 
-/**
- * Wczytanie ze stringa @p src wielomianu stałego.
- * @param[in] src : string wejściowy
- * @param[out] err : wskazuje na pierwszy niewczytany znak z @p src
- * @param[out] p : wielomian pod którym zapisany zostaje ewentualny wynik
- * @return powodzenie wczytania -- czy na wejściu obecne były jedynie właściwe
- * znaki.
- */
-static bool ParsePolyCoeff(char* src, char** err, Poly* p)
-{
-  poly_coeff_t c;
+/** Od jakiej długości linię z wielomianem parsujemy w kilku wątkach. */
+#define PARALLEL_PARSE_MIN (1 << 20)
 
-  c = strtol(src, err, 10);
+/** Najwięcej wątków parsujących jedną linię. */
+#define PARALLEL_PARSE_MAX 16
 
-  if (errno == ERANGE) {
-    errno = 0;
-    return false;
-  }
+/** Początkowy rozmiar buforów parsera. */
+#define PARSE_BUF_INIT_SIZE 16
 
-  if (**err != '\0' && **err != ',' && **err != '\n')
-    return false;
+/** Mnożnik powiększania buforów parsera. */
+#define PARSE_BUF_RESIZE 2
 
-  if (**err == '\n')
-    ++*err;
+/** Najdłuższy ciąg komend wstrzymany przez optymalizator. */
+#define PEEPHOLE_WINDOW 32
 
-  *p = PolyFromCoeff(c);
-  return true;
-}
+/**
+ * Komendy, które optymalizator potrafi łączyć. */
+enum PeepOp {
+  PEEP_CLONE,                   /**< `CLONE` */
+  PEEP_MUL,                     /**< `MUL` */
+  PEEP_NEG,                     /**< `NEG` */
+  PEEP_ZERO,                    /**< `ZERO` */
+  PEEP_ADD,                     /**< `ADD` */
+  PEEP_POP,                     /**< `POP` */
+  PEEP_OTHER                    /**< każda inna */
+};
+
+/**
+ * Reguły optymalizatora. */
+enum PeepRule {
+  RULE_SQUARE,                  /**< `CLONE MUL` to kwadrat */
+  RULE_POW,                     /**< ciąg `CLONE` i `MUL` to potęga */
+  RULE_ZERO_ADD,                /**< `ZERO ADD` nic nie zmienia */
+  RULE_NEG_NEG,                 /**< `NEG NEG` nic nie zmienia */
+  RULE_CLONE_POP,               /**< `CLONE POP` nic nie zmienia */
+  RULE_COUNT                    /**< liczba reguł */
+};
 
-static bool ParseMono(char* src, char** err, Mono* m);
+/**
+ * Wstrzymana komenda. */
+struct PeepCmd {
+  enum PeepOp op;               /**< komenda */
+  size_t linum;                 /**< numer jej wiersza */
+};
+
+/**
+ * Optymalizator ciągów komend. Komendy, od których może zaczynać się
+ * reguła, są wstrzymywane, dopóki następne pasują do reguły. Ciąg `CLONE` i
+ * `MUL` śledzony jest jako stos wykładników potęg wielomianu z czubka --
+ * gdy zejdzie do jednego, ciąg dotąd liczy jedną potęgę. Wstrzymane komendy,
+ * których nie udało się złączyć, wykonywane są zwyczajnie, więc błędy i
+ * niedopełnienia stosu zgłaszane są jak bez optymalizatora. */
+struct Peephole {
+  bool on;                      /**< czy optymalizator działa */
+  struct PeepCmd cmds[PEEPHOLE_WINDOW]; /**< wstrzymane komendy */
+  size_t count;                 /**< ich liczba */
+  poly_coeff_t exps[PEEPHOLE_WINDOW + 1]; /**< stos wykładników potęg */
+  size_t depth;                 /**< wysokość stosu wykładników */
+  size_t done;                  /**< ile komend liczy potęgę @p pow */
+  poly_coeff_t pow;             /**< wykładnik policzonej potęgi */
+  size_t fired[RULE_COUNT];     /**< ile razy zadziałała każda reguła */
+};
+
+/** Jedyny optymalizator; kalkulator ma jeden strumień komend. */
+static struct Peephole peephole;
+
+/** Nazwy komend z @ref PeepOp. */
+static char* const peep_names[] = {"CLONE", "MUL", "NEG", "ZERO", "ADD",
+                                   "POP"};
 
 /**
- * Próba sparsowania __wielomianu__ ze stringa @p src. Ustawia @p err na pierwszy
- * niewczytany znak (coś jak funkcja biblioteczna `strtod`) i pod @p p ładuje
- * wczytany wielomian.
- * @param[in] src : źródło do wczytania wielomianu zeń
- * @param[out] err : wskazuje pierwszy niewczytany znak
- * @param[out] p : miejsce na wynikowy wielomian
- * @return czy udało się wczytać wielomian
+ * Otwarcie nowego poziomu (listy jednomianów) w parserze.
+ * @param[in,out] pp : parser
  */
-static bool ParsePoly(char* src, char** err, Poly* p)
+static void PolyParserOpen(struct PolyParser* pp)
 {
-  /* kontrolowanie czy plusy pojawiły się tam gdzie trzeba */
-  bool plus_awaited = false;
-  Mono m;
-  *err = src;
-  *p = PolyZero();
+  if (pp->depth == pp->levels_size) {
+    pp->levels_size = pp->levels_size ? pp->levels_size * PARSE_BUF_RESIZE
+                                      : PARSE_BUF_INIT_SIZE;
+    pp->levels = realloc(pp->levels, pp->levels_size * sizeof(size_t));
 
-  if (isdigit(*src) || *src == '-')
-    return ParsePolyCoeff(src, err, p);
+    if (!pp->levels)
+      exit(1);
+  }
 
-  if (*src != '(')
-    return false;
+  pp->levels[pp->depth++] = pp->len;
+}
 
-  while (*src != ',' && *src != '\0') {
-    if (*src == '+' && !plus_awaited) {
-      PolyDestroy(p);
-      return false;
-    }
+/**
+ * Domknięcie jednomianu, którego współczynnikiem jest gotowy wielomian parsera,
+ * a wykładnikiem wczytana liczba. Niezerowy jednomian trafia do bufora.
+ * @param[in,out] pp : parser
+ */
+static void PolyParserAppend(struct PolyParser* pp)
+{
+  Mono m = MonoFromPoly(&pp->q, pp->acc);
 
-    if (*src == '+' || *src == '\n') {
-      plus_awaited = *src != '+' ? plus_awaited : false;
-      ++src;
-      continue;
-    }
+  pp->q = PolyZero();
 
-    if (*src != '(' || plus_awaited || !ParseMono(src, err, &m)) {
-      PolyDestroy(p);
-      return false;
-    }
+  if (PolyIsZero(&m.p))
+    return;
 
-    if (!PolyIsZero(&m.p))
-      MonoListInsert(&p->list, &m);
+  if (pp->len == pp->size) {
+    pp->size = pp->size ? pp->size * PARSE_BUF_RESIZE : PARSE_BUF_INIT_SIZE;
+    pp->monos = realloc(pp->monos, pp->size * sizeof(Mono));
 
-    assert(**err == ')');
-    src = ++*err;
-    plus_awaited = true;
+    if (!pp->monos)
+      exit(1);
   }
 
-  if (!plus_awaited) {
-    PolyDestroy(p);
-    return false;
-  }
+  pp->monos[pp->len++] = m;
+}
 
-  if (PolyIsPseudoCoeff(p->list))
-    Decoeffise(p);
+/**
+ * Domknięcie bieżącego poziomu parsera -- jego jednomiany stają się gotowym
+ * wielomianem.
+ * @param[in,out] pp : parser
+ */
+static void PolyParserClose(struct PolyParser* pp)
+{
+  size_t start = pp->levels[--pp->depth];
 
-  *err = src;
-  return true;
+  pp->q = PolyFromMonos(pp->len - start, pp->monos + start);
+  pp->len = start;
+  pp->state = PP_READY;
 }
 
 /**
- * Wczytanie jednomianu z tekstu.
- * @param[in] src : tekst wejściowy
- * @param[out] err : wskazuje pierwszy niewczytany znak
- * @param[out] m : zapisany jednomian
- * @return czy udało się wczytać poprawny jednomian
+ * Zamiana wczytanej liczby na gotowy wielomian stały.
+ * @param[in,out] pp : parser
  */
-static bool ParseMono(char* src, char** err, Mono* m)
+static void PolyParserCoeff(struct PolyParser* pp)
 {
-  Poly p = PolyZero();
-  long e;
+  pp->q = PolyFromCoeff(pp->neg ? -(poly_coeff_t)(pp->acc - 1) - 1
+                                : (poly_coeff_t)pp->acc);
+  pp->state = PP_READY;
+}
 
-  *err = src;
-  assert(*src == '(');
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+/** Czy cyfry dekodujemy po osiem naraz -- sztuczka wymaga little-endian. */
+#define PARSE_SWAR 1
+#else
+/** Czy cyfry dekodujemy po osiem naraz -- sztuczka wymaga little-endian. */
+#define PARSE_SWAR 0
+#endif
 
-  if (!ParsePoly(++src, err, &p)) {
-    return false;
-  } else if (**err != ',') {
-    /* jeśli udało się wczytać, ale brakuje przecinka, tzn, że musimy sami
-     * usunąć ten wielomian ponieważ ParsePoly tego nie zrobiło */
-    PolyDestroy(&p);
-    return false;
-  }
+/** Wartość ośmiu cyfr dziesiętnych, czyli mnożnik kroku SWAR. */
+#define SWAR_STEP 100000000UL
 
-  src = ++*err;
+#if PARSE_SWAR
+/**
+ * Sprawdzenie, czy wszystkie osiem bajtów słowa @p v to cyfry. Cyfra ma górną
+ * połówkę `3`, a po dodaniu `6` nadal nie przekracza `0x3f`.
+ * @param[in] v : osiem kolejnych znaków
+ * @return czy są to same cyfry
+ */
+static bool SwarIsDigits(uint64_t v)
+{
+  return ((v & 0xF0F0F0F0F0F0F0F0) |
+          (((v + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4)) ==
+         0x3333333333333333;
+}
 
-  /* po przecinku następuje dodatni wykładnik */
-  if (!isdigit(*src)) {
-    PolyDestroy(&p);
-    return false;
-  }
+/**
+ * Zamiana ośmiu cyfr na liczbę trzema mnożeniami zamiast ośmiu -- najpierw
+ * sklejamy sąsiednie cyfry w pary, potem pary w czwórki i czwórki w wynik.
+ * @param[in] v : osiem cyfr (pierwsza w najmłodszym bajcie)
+ * @return ich wartość
+ */
+static unsigned long SwarDecode(uint64_t v)
+{
+  v -= 0x3030303030303030;
+  v = v * 10 + (v >> 8);
+  v = (((v & 0x000000FF000000FF) * (100 + (1000000ULL << 32))) +
+       (((v >> 16) & 0x000000FF000000FF) * (1 + (10000ULL << 32)))) >> 32;
+  return v;
+}
+#endif
 
-  e = strtol(src, err, 10);
+/**
+ * Doczytanie cyfr liczby z kawałka tekstu. Dopóki przed @p end mieści się osiem
+ * znaków, cyfry dekodujemy całymi słowami, a resztę pojedynczo. Liczba może
+ * ciągnąć się dalej w następnym kawałku.
+ * @param[in,out] pp : parser
+ * @param[in,out] src : bieżąca pozycja w kawałku
+ * @param[in] end : koniec kawałka
+ * @param[in] limit : największa dopuszczalna wartość
+ * @return czy wartość mieści się w limicie
+ */
+static bool PolyParserDigits(struct PolyParser* pp, const char** src,
+                             const char* end, unsigned long limit)
+{
+  unsigned long acc = pp->acc;
+  unsigned long d;
+#if PARSE_SWAR
+  uint64_t v;
 
-  if (errno == ERANGE || e > EXP_MAX || e < 0) {
-    errno = 0;
-    PolyDestroy(&p);
-    return false;
+  while (end - *src >= 8) {
+    memcpy(&v, *src, sizeof(v));
+
+    if (!SwarIsDigits(v))
+      break;
+
+    d = SwarDecode(v);
+
+    if (d > limit || acc > (limit - d) / SWAR_STEP)
+      return false;
+
+    acc = acc * SWAR_STEP + d;
+    *src += 8;
   }
+#endif
 
-  if (**err != ')') {
-    PolyDestroy(&p);
-    return false;
+  for (; *src < end && isdigit(**src); ++*src) {
+    d = **src - '0';
+
+    if (acc > (limit - d) / 10)
+      return false;
+
+    acc = acc * 10 + d;
   }
 
-  *m = MonoFromPoly(&p, e);
+  pp->acc = acc;
   return true;
 }
 
+void PolyParserInit(struct PolyParser* pp)
+{
+  pp->state = PP_POLY;
+  pp->monos = NULL;
+  pp->len = 0;
+  pp->size = 0;
+  pp->levels = NULL;
+  pp->depth = 0;
+  pp->levels_size = 0;
+  pp->q = PolyZero();
+  pp->acc = 0;
+  pp->neg = false;
+  pp->nul = false;
+}
+
+void PolyParserFeed(struct PolyParser* pp, const char* src, size_t len)
+{
+  const char* end = src + len;
+  unsigned long limit;
+
+  while (src < end && pp->state != PP_FAIL) {
+    /* '\0' może co najwyżej zakończyć tekst */
+    if (pp->nul) {
+      pp->state = PP_FAIL;
+      break;
+    }
+
+    if (*src == '\0') {
+      pp->nul = true;
+      ++src;
+      continue;
+    }
+
+    switch (pp->state) {
+    case PP_POLY:
+      if (*src == '(') {
+        PolyParserOpen(pp);
+        ++src;
+      } else if (*src == '-' || isdigit(*src)) {
+        pp->neg = *src == '-';
+        pp->acc = 0;
+        pp->state = pp->neg ? PP_SIGN : PP_COEFF;
+        src += pp->neg;
+      } else {
+        pp->state = PP_FAIL;
+      }
+      break;
+
+    case PP_SIGN:
+      pp->state = isdigit(*src) ? PP_COEFF : PP_FAIL;
+      break;
+
+    case PP_COEFF:
+      limit = pp->neg ? (unsigned long)LONG_MAX + 1 : LONG_MAX;
+
+      if (!PolyParserDigits(pp, &src, end, limit)) {
+        pp->state = PP_FAIL;
+      } else if (src < end) {
+        PolyParserCoeff(pp);
+
+        if (*src == '\n')
+          ++src;
+      }
+      break;
+
+    case PP_READY:
+      if (pp->depth > 0 && *src == ',') {
+        pp->state = PP_EXP_START;
+        ++src;
+      } else {
+        pp->state = PP_FAIL;
+      }
+      break;
+
+    case PP_EXP_START:
+      pp->acc = 0;
+      pp->state = isdigit(*src) ? PP_EXP : PP_FAIL;
+      break;
+
+    case PP_EXP:
+      if (!PolyParserDigits(pp, &src, end, EXP_MAX)) {
+        pp->state = PP_FAIL;
+      } else if (src < end && *src != ')') {
+        pp->state = PP_FAIL;
+      } else if (src < end) {
+        PolyParserAppend(pp);
+        pp->state = PP_MONO;
+        ++src;
+      }
+      break;
+
+    case PP_MONO:
+      if (*src == '\n') {
+        ++src;
+      } else if (*src == '+') {
+        pp->state = PP_PLUS;
+        ++src;
+      } else {
+        PolyParserClose(pp);
+      }
+      break;
+
+    case PP_PLUS:
+      if (*src == '\n') {
+        ++src;
+      } else if (*src == '(') {
+        pp->state = PP_POLY;
+        ++src;
+      } else {
+        pp->state = PP_FAIL;
+      }
+      break;
+
+    case PP_FAIL:
+      break;
+    }
+  }
+}
+
 /**
  * Wypisanie wyjątku wczytywaniowego na wyjście diagnostyczne.
  * @param[in] linum : numer wiersza, na którym znajduje się błąd
@@ -183,6 +392,46 @@ static void ErrorTraceback(size_t linum, char* message)
   fprintf(stderr, "ERROR %lu %s\n", linum, message);
 }
 
+bool PolyParserTake(struct PolyParser* pp, Poly* p)
+{
+  bool correct;
+
+  if (pp->state == PP_COEFF)
+    PolyParserCoeff(pp);
+  else if (pp->state == PP_MONO)
+    PolyParserClose(pp);
+
+  if ((correct = pp->state == PP_READY && pp->depth == 0))
+    *p = pp->q;
+  else
+    PolyDestroy(&pp->q);
+
+  for (size_t i = 0; i < pp->len; ++i)
+    MonoDestroy(pp->monos + i);
+
+  free(pp->monos);
+  free(pp->levels);
+  return correct;
+}
+
+void PushParsedPoly(struct Stack* stack, Poly* p, bool correct, size_t linum)
+{
+  PeepholeFlush(stack);
+
+  if (correct)
+    PushPoly(stack, p);
+  else
+    ErrorTraceback(linum, "WRONG POLY");
+}
+
+void PolyParserFinish(struct PolyParser* pp, size_t linum, struct Stack* stack)
+{
+  Poly p;
+  bool correct = PolyParserTake(pp, &p);
+
+  PushParsedPoly(stack, &p, correct, linum);
+}
+
 /**
  * Sprawdza, czy dana komenda jest jedną z komend argumentowych. Sprawdza napis
  * @p src pod kątem jakichś spacji. W przypadku ich znalezienia zwraca `true`
@@ -230,41 +479,376 @@ static void ParseCommand(char* cmnd, char* arg, size_t linum,
 static bool IsArgd(char* cmnd)
 {
   return strcmp(cmnd, "DEG_BY") == 0 || strcmp(cmnd, "AT") == 0 ||
-         strcmp(cmnd, "COMPOSE") == 0;
+         strcmp(cmnd, "COMPOSE") == 0 || strcmp(cmnd, "MUL_TRUNC") == 0 ||
+         strcmp(cmnd, "TRUNC") == 0 || strcmp(cmnd, "AT_VAR") == 0 ||
+         strcmp(cmnd, "POW") == 0 ||
+         strcmp(cmnd, "SAVE") == 0 || strcmp(cmnd, "LOAD") == 0 ||
+         strcmp(cmnd, "FREEZE") == 0 || strcmp(cmnd, "MAP") == 0 ||
+         strcmp(cmnd, "CHECKPOINT") == 0 || strcmp(cmnd, "RESTORE") == 0;
+}
+
+/**
+ * Kawałek linii z wielomianem parsowany w osobnym wątku -- ciąg jednomianów
+ * najwyższego poziomu.
+ */
+struct ParseTask {
+  const char* src;              /**< początek kawałka */
+  size_t len;                   /**< długość kawałka */
+  Poly p;                       /**< suma jednomianów kawałka */
+  bool correct;                 /**< czy kawałek jest poprawną sumą */
+};
+
+/**
+ * Wczytanie kawałka. Poprawny jest tylko kawałek będący sumą jednomianów, a
+ * nie współczynnikiem, bo tylko takie można łączyć plusami.
+ * @param[in,out] arg : kawałek
+ * @return `NULL`
+ */
+static void* ParseTaskRun(void* arg)
+{
+  struct ParseTask* t = arg;
+  struct PolyParser pp;
+
+  PolyParserInit(&pp);
+  PolyParserFeed(&pp, t->src, t->len);
+  t->correct = PolyParserTake(&pp, &t->p);
+
+  if (t->correct && (t->len == 0 || *t->src != '(')) {
+    PolyDestroy(&t->p);
+    t->correct = false;
+  }
+
+  return NULL;
+}
+
+/**
+ * Podział długiej linii z wielomianem na co najwyżej @p n kawałków przy
+ * plusach najwyższego poziomu, możliwie równej długości. Linie o
+ * niezrównoważonych nawiasach bądź ze znakiem '`\0`' przed końcem zostawiamy
+ * w całości, żeby o ich poprawności rozstrzygał zwykły parser.
+ * @param[in] src : linia
+ * @param[in] len : długość linii
+ * @param[in] n : najwięcej kawałków
+ * @param[out] tasks : kawałki
+ * @return liczba kawałków
+ */
+static size_t SplitPoly(const char* src, size_t len, size_t n,
+                        struct ParseTask tasks[])
+{
+  size_t count = 0;
+  size_t start = 0;
+  long depth = 0;
+
+  for (size_t i = 0; i < len; ++i) {
+    if (src[i] == '(') {
+      ++depth;
+    } else if (src[i] == ')') {
+      if (--depth < 0)
+        return 0;
+    } else if (src[i] == '\0' && i + 1 < len) {
+      return 0;
+    } else if (src[i] == '+' && depth == 0 && count + 1 < n &&
+               i >= (count + 1) * (len / n)) {
+      tasks[count].src = src + start;
+      tasks[count++].len = i - start;
+      start = i + 1;
+    }
+  }
+
+  tasks[count].src = src + start;
+  tasks[count++].len = len - start;
+  return depth == 0 ? count : 0;
+}
+
+/**
+ * Wczytanie linii z wielomianem i odłożenie go na stos. Długie linie dzielimy
+ * przy plusach najwyższego poziomu i kawałki parsujemy w osobnych wątkach, a
+ * ich sumy łączymy akumulatorem. Linia jest poprawna dokładnie wtedy, gdy
+ * każdy kawałek jest poprawną sumą jednomianów, więc błędy są te same co przy
+ * parsowaniu w jednym kawałku.
+ * @param[in] src : linia
+ * @param[in] len : długość linii
+ * @param[in] linum : numer wiersza
+ * @param[in,out] stack : stos kalkulacyjny
+ */
+static void ParsePoly(const char* src, size_t len, size_t linum,
+                      struct Stack* stack)
+{
+  struct ParseTask tasks[PARALLEL_PARSE_MAX];
+  pthread_t threads[PARALLEL_PARSE_MAX];
+  bool started[PARALLEL_PARSE_MAX];
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  size_t n = cpus < PARALLEL_PARSE_MAX ? (cpus > 0 ? cpus : 1)
+                                        : PARALLEL_PARSE_MAX;
+  struct PolyParser pp;
+  Geobucket sum;
+  Poly p;
+  bool correct = true;
+
+  if (len < PARALLEL_PARSE_MIN || n < 2 ||
+      (n = SplitPoly(src, len, n, tasks)) < 2) {
+    PolyParserInit(&pp);
+    PolyParserFeed(&pp, src, len);
+    PolyParserFinish(&pp, linum, stack);
+    return;
+  }
+
+  /* pierwszy kawałek bierze bieżący wątek; gdy wątku nie da się utworzyć,
+   * kawałek też parsujemy od razu */
+  for (size_t i = 1; i < n; ++i) {
+    started[i] = pthread_create(threads + i, NULL, ParseTaskRun,
+                                tasks + i) == 0;
+
+    if (!started[i])
+      ParseTaskRun(tasks + i);
+  }
+
+  ParseTaskRun(tasks);
+  GeobucketInit(&sum);
+
+  for (size_t i = 0; i < n; ++i) {
+    if (i > 0 && started[i])
+      pthread_join(threads[i], NULL);
+
+    if (tasks[i].correct)
+      GeobucketInsert(&sum, &tasks[i].p);
+    else
+      correct = false;
+  }
+
+  p = GeobucketFinalise(&sum);
+
+  if (!correct)
+    PolyDestroy(&p);
+
+  PushParsedPoly(stack, &p, correct, linum);
+}
+
+/**
+ * Rozpoznanie komendy dla optymalizatora.
+ * @param[in] cmnd : komenda
+ * @return komenda z @ref PeepOp
+ */
+static enum PeepOp PeepOpOf(const char* cmnd)
+{
+  for (enum PeepOp op = PEEP_CLONE; op < PEEP_OTHER; ++op) {
+    if (strcmp(cmnd, peep_names[op]) == 0)
+      return op;
+  }
+
+  return PEEP_OTHER;
+}
+
+/**
+ * Zwyczajne wykonanie wstrzymanych komend od @p from-tej i opróżnienie
+ * optymalizatora.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] from : pierwsza komenda do wykonania
+ */
+static void PeepholeReplay(struct Stack* stack, size_t from)
+{
+  size_t count = peephole.count;
+
+  peephole.count = 0;
+
+  for (size_t i = from; i < count; ++i)
+    ParseCommand(peep_names[peephole.cmds[i].op], "", peephole.cmds[i].linum,
+                 stack);
+}
+
+/**
+ * Wstrzymanie komendy.
+ * @param[in] op : komenda
+ * @param[in] linum : numer jej wiersza
+ */
+static void PeepholePush(enum PeepOp op, size_t linum)
+{
+  peephole.cmds[peephole.count].op = op;
+  peephole.cmds[peephole.count].linum = linum;
+  ++peephole.count;
+}
+
+/**
+ * Wykonanie dwóch wstrzymanych komend, które razem nic nie zmieniają. Gdy
+ * stos jest pusty, pierwsza i tak zgłasza błąd, więc wtedy wykonujemy je
+ * zwyczajnie.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] rule : reguła, która zadziałała
+ */
+static void PeepholeCancel(struct Stack* stack, enum PeepRule rule)
+{
+  if (stack->height < 1) {
+    PeepholeReplay(stack, 0);
+    return;
+  }
+
+  ++peephole.fired[rule];
+  peephole.count = 0;
+}
+
+/**
+ * Dołożenie komendy do wstrzymanego ciągu.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] op : komenda
+ * @param[in] linum : numer jej wiersza
+ * @return czy komenda pasuje do ciągu
+ */
+static bool PeepholeExtend(struct Stack* stack, enum PeepOp op, size_t linum)
+{
+  enum PeepOp first = peephole.cmds[0].op;
+
+  if (peephole.count == 1 && ((first == PEEP_NEG && op == PEEP_NEG) ||
+                              (first == PEEP_ZERO && op == PEEP_ADD) ||
+                              (first == PEEP_CLONE && op == PEEP_POP))) {
+    PeepholePush(op, linum);
+    PeepholeCancel(stack, first == PEEP_NEG    ? RULE_NEG_NEG
+                          : first == PEEP_ZERO ? RULE_ZERO_ADD
+                                               : RULE_CLONE_POP);
+    return true;
+  }
+
+  if (first != PEEP_CLONE || peephole.count == PEEPHOLE_WINDOW)
+    return false;
+
+  if (op == PEEP_CLONE) {
+    peephole.exps[peephole.depth] = peephole.exps[peephole.depth - 1];
+    ++peephole.depth;
+  } else if (op == PEEP_MUL && peephole.depth >= 2) {
+    --peephole.depth;
+    peephole.exps[peephole.depth - 1] += peephole.exps[peephole.depth];
+  } else {
+    return false;
+  }
+
+  PeepholePush(op, linum);
+
+  if (peephole.depth == 1) {
+    peephole.done = peephole.count;
+    peephole.pow = peephole.exps[0];
+  }
+
+  return true;
+}
+
+void PeepholeFlush(struct Stack* stack)
+{
+  bool fits = false;
+
+  if (peephole.count == 0)
+    return;
+
+  /* potęga wymaga tylko niepustego stosu, reszta ciągu idzie zwyczajnie;
+   * gdy wykładniki potęgi się nie mieszczą, wykonujemy cały ciąg komend */
+  if (peephole.cmds[0].op == PEEP_CLONE && peephole.done > 0 &&
+      stack->height >= 1 && Pow(stack, peephole.pow, &fits) && fits) {
+    ++peephole.fired[peephole.pow == 2 ? RULE_SQUARE : RULE_POW];
+    PeepholeReplay(stack, peephole.done);
+  } else {
+    PeepholeReplay(stack, 0);
+  }
+}
+
+/**
+ * Przekazanie komendy optymalizatorowi.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] cmnd : komenda bez argumentu
+ * @param[in] linum : numer jej wiersza
+ * @return czy optymalizator przejął komendę
+ */
+static bool PeepholeFeed(struct Stack* stack, char* cmnd, size_t linum)
+{
+  enum PeepOp op;
+
+  if (!peephole.on)
+    return false;
+
+  op = PeepOpOf(cmnd);
+
+  if (peephole.count > 0 && PeepholeExtend(stack, op, linum))
+    return true;
+
+  PeepholeFlush(stack);
+
+  if (op != PEEP_CLONE && op != PEEP_NEG && op != PEEP_ZERO)
+    return false;
+
+  PeepholePush(op, linum);
+  peephole.exps[0] = peephole.exps[1] = 1;
+  peephole.depth = 2;
+  peephole.done = 0;
+  return true;
+}
+
+void PeepholeEnable(void)
+{
+  peephole.on = true;
+}
+
+void PeepholeReport(void)
+{
+  fprintf(stderr, "peephole: CLONE MUL %zu, CLONE/MUL power %zu, ZERO ADD %zu, "
+          "NEG NEG %zu, CLONE POP %zu\n", peephole.fired[RULE_SQUARE],
+          peephole.fired[RULE_POW], peephole.fired[RULE_ZERO_ADD],
+          peephole.fired[RULE_NEG_NEG], peephole.fired[RULE_CLONE_POP]);
 }
 
 void ParseLine(char* src, size_t len, size_t linum, struct Stack* stack)
 {
-  Poly p = PolyZero();
-  bool parsed;
-  char* err;
   char* cmnd = src;
   char* arg;
 
   if (!isalpha(*src)) {
-    parsed = ParsePoly(src, &err, &p);
-    if (parsed && *err == '\0') {
-      PushPoly(stack, &p);
-    } else {
-      /* jeśli udało się wczytać wielomian, ALE brakuje \n, to nie usunął
-       * go ParsePoly, a jest do wyrzucenia */
-      if (parsed && *err != '\0')
-        PolyDestroy(&p);
-
-      ErrorTraceback(linum, "WRONG POLY");
-    }
-
+    ParsePoly(src, len, linum, stack);
     return;
   }
 
   /* szukam argumentu i ustawiam odpowiednio arg. jeśli znajdę argument, to
    * sprawdzam czy cmnd jest dwuargumentowa, inaczej istnienie arg to błąd */
   if (FindArg(src, len, &arg) && !IsArgd(cmnd)) {
+    PeepholeFlush(stack);
     ErrorTraceback(linum, "WRONG COMMAND");
     return;
   }
 
-  ParseCommand(cmnd, arg, linum, stack);
+  if (!PeepholeFeed(stack, cmnd, linum))
+    ParseCommand(cmnd, arg, linum, stack);
+}
+
+/**
+ * Wczytanie ograniczenia stopnia dla komend obcinających. Akceptowane są te same
+ * wartości co dla wykładników jednomianów.
+ * @param[in] arg : argument komendy
+ * @param[out] deg : wczytany stopień
+ * @return czy argument jest poprawny
+ */
+static bool ParseDegArg(char* arg, poly_exp_t* deg)
+{
+  char* err;
+  long d;
+
+  if (!isdigit(*arg))
+    return false;
+
+  d = strtol(arg, &err, 10);
+
+  if (errno == ERANGE || *err != '\0' || d > EXP_MAX) {
+    errno = 0;
+    return false;
+  }
+
+  *deg = d;
+  return true;
+}
+
+/**
+ * Sprawdzenie argumentu komend plikowych -- niepustej ścieżki oddzielonej od
+ * komendy pojedynczą spacją.
+ * @param[in] arg : argument komendy
+ * @return czy argument może być ścieżką
+ */
+static bool IsPathArg(char* arg)
+{
+  return *arg != '\0' && !isspace(*arg);
 }
 
 /**
@@ -279,11 +863,16 @@ static void ParseCommand(char* cmnd, char* arg, size_t linum,
                          struct Stack* stack)
 {
   unsigned long long idx;
+  unsigned long long n;
+  poly_exp_t deg;
   poly_coeff_t x;
   size_t k;
   char* err;
+  char* val;
   /* czy nie nastąpiło niedopełnienie stosu */
   bool stacked = true;
+  bool saved = true;
+  bool fits = true;
 
   if (strcmp(cmnd, "ADD") == 0) {
     stacked = Add(stack);
@@ -303,6 +892,8 @@ static void ParseCommand(char* cmnd, char* arg, size_t linum,
     stacked = Sub(stack);
   } else if (strcmp(cmnd, "IS_EQ") == 0) {
     stacked = IsEq(stack);
+  } else if (strcmp(cmnd, "IS_EQ_FAST") == 0) {
+    stacked = IsEqFast(stack);
   } else if (strcmp(cmnd, "DEG") == 0) {
     stacked = Deg(stack);
   } else if (strcmp(cmnd, "PRINT") == 0) {
@@ -337,6 +928,71 @@ static void ParseCommand(char* cmnd, char* arg, size_t linum,
     } else {
       stacked = Compose(stack, k);
     }
+  } else if (strcmp(cmnd, "AT_VAR") == 0) {
+    /* dwa argumenty rozdzielone pojedynczą spacją: indeks i wartość */
+    val = strchr(arg, ' ');
+
+    if (val)
+      *val++ = '\0';
+
+    idx = strtoull(arg, &err, 10);
+
+    if (!isdigit(*arg) || errno == ERANGE || *err != '\0' || idx > SIZE_MAX) {
+      errno = 0;
+      ErrorTraceback(linum, "AT VAR WRONG VARIABLE");
+    } else if (!val) {
+      ErrorTraceback(linum, "AT VAR WRONG VALUE");
+    } else {
+      x = strtol(val, &err, 10);
+
+      if (!(isdigit(*val) || *val == '-') || errno == ERANGE || *err != '\0') {
+        errno = 0;
+        ErrorTraceback(linum, "AT VAR WRONG VALUE");
+      } else {
+        stacked = AtVar(stack, idx, x);
+      }
+    }
+  } else if (strcmp(cmnd, "MUL_TRUNC") == 0) {
+    if (!ParseDegArg(arg, &deg))
+      ErrorTraceback(linum, "MUL TRUNC WRONG DEGREE");
+    else
+      stacked = MulTrunc(stack, deg);
+  } else if (strcmp(cmnd, "TRUNC") == 0) {
+    if (!ParseDegArg(arg, &deg))
+      ErrorTraceback(linum, "TRUNC WRONG DEGREE");
+    else
+      stacked = Trunc(stack, deg);
+  } else if (strcmp(cmnd, "POW") == 0) {
+    n = strtoull(arg, &err, 10);
+
+    if (!isdigit(*arg) || errno == ERANGE || *err != '\0' || n > LONG_MAX) {
+      errno = 0;
+      ErrorTraceback(linum, "POW WRONG EXPONENT");
+    } else if ((stacked = Pow(stack, n, &fits)) && !fits) {
+      ErrorTraceback(linum, "POW WRONG EXPONENT");
+    }
+  } else if (strcmp(cmnd, "SAVE") == 0) {
+    if (!IsPathArg(arg))
+      ErrorTraceback(linum, "SAVE WRONG FILE");
+    else if ((stacked = Save(stack, arg, &saved)) && !saved)
+      ErrorTraceback(linum, "SAVE WRONG FILE");
+  } else if (strcmp(cmnd, "LOAD") == 0) {
+    if (!IsPathArg(arg) || !Load(stack, arg))
+      ErrorTraceback(linum, "LOAD WRONG FILE");
+  } else if (strcmp(cmnd, "FREEZE") == 0) {
+    if (!IsPathArg(arg))
+      ErrorTraceback(linum, "FREEZE WRONG FILE");
+    else if ((stacked = Freeze(stack, arg, &saved)) && !saved)
+      ErrorTraceback(linum, "FREEZE WRONG FILE");
+  } else if (strcmp(cmnd, "MAP") == 0) {
+    if (!IsPathArg(arg) || !Map(stack, arg))
+      ErrorTraceback(linum, "MAP WRONG FILE");
+  } else if (strcmp(cmnd, "CHECKPOINT") == 0) {
+    if (!IsPathArg(arg) || !Checkpoint(stack, arg))
+      ErrorTraceback(linum, "CHECKPOINT WRONG FILE");
+  } else if (strcmp(cmnd, "RESTORE") == 0) {
+    if (!IsPathArg(arg) || !Restore(stack, arg))
+      ErrorTraceback(linum, "RESTORE WRONG FILE");
   } else {
     ErrorTraceback(linum, "WRONG COMMAND");
   }
@@ -12,6 +12,85 @@
 
 #include "stack_op.h"
 
+/**
+ * Miejsce w gramatyce wielomianu, w którym zatrzymał się parser po ostatnim
+ * kawałku tekstu. */
+enum PolyParserState {
+  PP_POLY,                      /**< początek wielomianu */
+  PP_SIGN,                      /**< po minusie współczynnika */
+  PP_COEFF,                     /**< wśród cyfr współczynnika */
+  PP_READY,                     /**< wielomian gotowy, czeka na przecinek */
+  PP_EXP_START,                 /**< po przecinku */
+  PP_EXP,                       /**< wśród cyfr wykładnika */
+  PP_MONO,                      /**< po nawiasie zamykającym jednomian */
+  PP_PLUS,                      /**< po plusie */
+  PP_FAIL                       /**< tekst okazał się niepoprawny */
+};
+
+/**
+ * Przyrostowy parser wielomianów. Tekst można mu podawać kawałkami dowolnej
+ * długości, a wielomian budowany jest na bieżąco, więc długiej linii nie trzeba
+ * trzymać w całości w pamięci. Zamiast rekurencji po zagnieżdżeniach trzymamy
+ * jawny stos poziomów. Jednomiany wszystkich otwartych poziomów leżą w jednym
+ * buforze -- poziom zajmuje jego spójny sufiks od miejsca zapisanego w
+ * `levels`, a po domknięciu zamieniany jest w wielomian przez `PolyFromMonos`
+ * i zdejmowany z bufora. */
+struct PolyParser {
+  enum PolyParserState state;   /**< bieżące miejsce w gramatyce */
+  Mono* monos;                  /**< bufor jednomianów otwartych poziomów */
+  size_t len;                   /**< liczba jednomianów w buforze */
+  size_t size;                  /**< pojemność bufora */
+  size_t* levels;               /**< początki poziomów w buforze */
+  size_t depth;                 /**< liczba otwartych poziomów */
+  size_t levels_size;           /**< pojemność stosu poziomów */
+  Poly q;                       /**< ostatni gotowy wielomian */
+  unsigned long acc;            /**< dotychczas wczytana część liczby */
+  bool neg;                     /**< czy współczynnik jest ujemny */
+  bool nul;                     /**< czy wczytano już znak '\0' */
+};
+
+/**
+ * Przygotowanie parsera do wczytania nowego wielomianu.
+ * @param[out] pp : parser
+ */
+void PolyParserInit(struct PolyParser* pp);
+
+/**
+ * Wczytanie kolejnego kawałka tekstu wielomianu.
+ * @param[in,out] pp : parser
+ * @param[in] src : kawałek tekstu
+ * @param[in] len : jego długość
+ */
+void PolyParserFeed(struct PolyParser* pp, const char* src, size_t len);
+
+/**
+ * Zakończenie wczytywania wielomianu. Zwalnia pamięć parsera.
+ * @param[in,out] pp : parser
+ * @param[out] p : wczytany wielomian, jeśli tekst był poprawny
+ * @return czy tekst był poprawnym wielomianem
+ */
+bool PolyParserTake(struct PolyParser* pp, Poly* p);
+
+/**
+ * Odłożenie na stos wielomianu wczytanego z @p linum-tej linii bądź, jeśli
+ * tekst nie był poprawny, wypisanie błędu.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] p : wielomian z @ref PolyParserTake
+ * @param[in] correct : wynik @ref PolyParserTake
+ * @param[in] linum : numer wiersza
+ */
+void PushParsedPoly(struct Stack* stack, Poly* p, bool correct, size_t linum);
+
+/**
+ * Zakończenie wczytywania wielomianu z @p linum-tej linii. Poprawny wielomian
+ * trafia na stos @p stack, a w przeciwnym razie wypisywany jest błąd. Zwalnia
+ * pamięć parsera.
+ * @param[in,out] pp : parser
+ * @param[in] linum : numer obecnego wiersza
+ * @param[in,out] stack : stos kalkulacyjny
+ */
+void PolyParserFinish(struct PolyParser* pp, size_t linum, struct Stack* stack);
+
 /**
  * Odpowiednie wczytanie komendy z @p linum-tej linii @p src i wywołanie
  * stosownych operacji na stosie kalkulacyjnym @p stack.
@@ -22,4 +101,24 @@
  */
 void ParseLine(char* src, size_t len, size_t linum, struct Stack* stack);
 
+/**
+ * Włączenie optymalizatora ciągów komend. Rozpoznaje on `CLONE MUL` jako
+ * kwadrat, ciągi `CLONE` i `MUL` jako potęgi, a `ZERO ADD`, `NEG NEG` i
+ * `CLONE POP` pomija. Wyjście i komunikaty błędów się nie zmieniają.
+ */
+void PeepholeEnable(void);
+
+/**
+ * Wykonanie komend wstrzymanych przez optymalizator. Trzeba je wykonać na
+ * końcu wejścia.
+ * @param[in,out] stack : stos kalkulacyjny
+ */
+void PeepholeFlush(struct Stack* stack);
+
+/**
+ * Wypisanie na standardowe wyjście błędów, ile razy zadziałała każda reguła
+ * optymalizatora.
+ */
+void PeepholeReport(void);
+
 #endif  /* _PARSE_H_ */
@@ -0,0 +1,41 @@
+/** @file
+  Implementacja kolejki między wątkami z pliku pipe.h.
+
+  @author Grzegorz Cichosz <g.cichosz@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date czerwiec 2021
+*/
+
+#include <sched.h>
+
+#include "pipe.h"
+
+void PipeInit(struct Pipe* pipe)
+{
+  atomic_init(&pipe->head, 0);
+  atomic_init(&pipe->tail, 0);
+}
+
+void PipePush(struct Pipe* pipe, const struct PipeItem* item)
+{
+  size_t tail = atomic_load_explicit(&pipe->tail, memory_order_relaxed);
+
+  /* czekając oddajemy procesor -- na jednym rdzeniu to konsument musi ruszyć */
+  while (tail - atomic_load_explicit(&pipe->head, memory_order_acquire) ==
+         PIPE_SIZE)
+    sched_yield();
+
+  pipe->items[tail % PIPE_SIZE] = *item;
+  atomic_store_explicit(&pipe->tail, tail + 1, memory_order_release);
+}
+
+void PipePop(struct Pipe* pipe, struct PipeItem* item)
+{
+  size_t head = atomic_load_explicit(&pipe->head, memory_order_relaxed);
+
+  while (atomic_load_explicit(&pipe->tail, memory_order_acquire) == head)
+    sched_yield();
+
+  *item = pipe->items[head % PIPE_SIZE];
+  atomic_store_explicit(&pipe->head, head + 1, memory_order_release);
+}
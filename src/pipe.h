@@ -0,0 +1,76 @@
+/** @file
+  Ograniczona kolejka bez blokad między dwoma wątkami kalkulatora: wątkiem
+  czytającym i parsującym wejście oraz wątkiem wykonującym komendy. Kolejka
+  ma jednego producenta i jednego konsumenta, więc wystarczą jej dwa liczniki
+  atomowe.
+
+  @author Grzegorz Cichosz <g.cichosz@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date czerwiec 2021
+*/
+
+#ifndef _PIPE_H_
+#define _PIPE_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "poly.h"
+
+/**
+ * Pojemność kolejki; potęga dwójki. */
+#define PIPE_SIZE 64
+
+/**
+ * Rodzaj pozycji kolejki. */
+enum PipeKind {
+  PIPE_POLY,                    /**< wczytany wielomian bądź błędny tekst */
+  PIPE_LINE,                    /**< linia z komendą do wykonania */
+  PIPE_END                      /**< koniec wejścia */
+};
+
+/**
+ * Pozycja kolejki -- jedna niepusta, niekomentarzowa linia wejścia. */
+struct PipeItem {
+  enum PipeKind kind;           /**< rodzaj pozycji */
+  size_t linum;                 /**< numer linii */
+  Poly p;                       /**< wielomian dla @ref PIPE_POLY */
+  bool correct;                 /**< czy tekst wielomianu był poprawny */
+  char* line;                   /**< linia dla @ref PIPE_LINE, do zwolnienia
+                                     przez konsumenta */
+  size_t len;                   /**< długość linii */
+};
+
+/**
+ * Kolejka. Liczniki leżą w osobnych liniach pamięci podręcznej, by wątki nie
+ * przepychały ich sobie nawzajem. */
+struct Pipe {
+  struct PipeItem items[PIPE_SIZE]; /**< pozycje */
+  _Alignas(64) atomic_size_t head;  /**< liczba zdjętych pozycji */
+  _Alignas(64) atomic_size_t tail;  /**< liczba włożonych pozycji */
+};
+
+/**
+ * Przygotowanie pustej kolejki.
+ * @param[out] pipe : kolejka
+ */
+void PipeInit(struct Pipe* pipe);
+
+/**
+ * Włożenie pozycji do kolejki; przy pełnej kolejce czeka na konsumenta.
+ * Wywołuje tylko producent.
+ * @param[in,out] pipe : kolejka
+ * @param[in] item : pozycja
+ */
+void PipePush(struct Pipe* pipe, const struct PipeItem* item);
+
+/**
+ * Zdjęcie pozycji z kolejki; przy pustej kolejce czeka na producenta.
+ * Wywołuje tylko konsument.
+ * @param[in,out] pipe : kolejka
+ * @param[out] item : pozycja
+ */
+void PipePop(struct Pipe* pipe, struct PipeItem* item);
+
+#endif  /* _PIPE_H_ */
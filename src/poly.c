@@ -46,22 +46,21 @@ Poly PolyAdd(const Poly* p, const Poly* q)
   return new;
 }
 
-/**
- * Funkcja porządkująca wielomiany dla qsorta.
- * @param[in] m : jednomian jako `void*`
- * @param[in] t : jednomian jako `void*`
- * @return wynik z MonoCmp z poly_lib.c
- */
-static int MonoCmpQsort(const void* m, const void* t)
+Poly PolyAddOwn(Poly* p, Poly* q)
 {
-  return MonoCmp((Mono*)m, (Mono*)t);
+  Poly sum = *PolyIncorporate(p, q);
+
+  /* po złączeniu p i q to te same struktury, należące teraz do sumy */
+  *p = *q = PolyZero();
+  return sum;
 }
 
 Poly PolyMul(const Poly* p, const Poly* q)
 {
-  Poly pq = PolyZero();
-  /* jednomiany należące do wielomianów p, q i p * q */
-  Mono pm, qm, pqm;
+  PolyShape ps, qs;
+  Geobucket pq;
+  const Poly* tmp;
+  Poly row;
 
   if (PolyIsCoeff(p))
     return PolyMulCoeff(q, p->coeff);
@@ -69,20 +68,95 @@ Poly PolyMul(const Poly* p, const Poly* q)
   if (PolyIsCoeff(q))
     return PolyMulCoeff(p, q->coeff);
 
+  if (!p->list->tail)
+    return PolyMulMono(q, &p->list->m);
+
+  if (!q->list->tail)
+    return PolyMulMono(p, &q->list->m);
+
+  PolyShapeOf(p, 1, &ps);
+  PolyShapeOf(q, 1, &qs);
+
+  if (PolyShapeFitsDense(&ps, &qs))
+    return PolyMulDense(p, q);
+
+  /* wierszy jest tyle, ile jednomianów ma p -- mniej, dłuższych wierszy to
+   * mniej przelewania kubełków */
+  if (qs.terms[0] < ps.terms[0]) {
+    tmp = p;
+    p = q;
+    q = tmp;
+  }
+
+  /* iloczyn q przez jednomian z p to już posortowany wiersz -- wiersze
+   * sumujemy w akumulatorze zamiast wstawiać każdy jednomian z osobna */
+  GeobucketInit(&pq);
+
   for (MonoList* pl = p->list; pl; pl = pl->tail) {
-    for (MonoList* ql = q->list; ql; ql = ql->tail) {
-      pm = pl->m;
-      qm = ql->m;
-      pqm = MonoMul(&pm, &qm);
+    row = PolyMulMono(q, &pl->m);
+    GeobucketInsert(&pq, &row);
+  }
 
-      if (PolyIsZero(&pqm.p))
-        MonoDestroy(&pqm);
-      else
-        MonoListInsert(&pq.list, &pqm);
+  return GeobucketFinalise(&pq);
+}
+
+Poly PolyMulOwn(Poly* p, Poly* q)
+{
+  PolyShape ps, qs;
+  Geobucket pq;
+  MonoList* pl;
+  Poly* tmp;
+  Poly row;
+
+  if (PolyIsCoeff(p) || PolyIsCoeff(q)) {
+    if (PolyIsCoeff(p))
+      PolyMulCoeffComp(q, p->coeff);
+    else
+      PolyMulCoeffComp(p, q->coeff);
+
+    row = PolyIsCoeff(p) ? *q : *p;
+    *p = *q = PolyZero();
+    return row;
+  }
+
+  PolyShapeOf(p, 1, &ps);
+  PolyShapeOf(q, 1, &qs);
+
+  if (PolyShapeFitsDense(&ps, &qs)) {
+    row = PolyMulDense(p, q);
+    PolyDestroy(p);
+    PolyDestroy(q);
+    *p = *q = PolyZero();
+    return row;
+  }
+
+  if (qs.terms[0] < ps.terms[0]) {
+    tmp = p;
+    p = q;
+    q = tmp;
+  }
+
+  GeobucketInit(&pq);
+
+  /* wiersze liczone są z q, a ostatni z nich powstaje w miejscu -- na
+   * jednomianach q, które nie są już dalej potrzebne */
+  while ((pl = p->list)) {
+    if (pl->tail) {
+      row = PolyMulMono(q, &pl->m);
+    } else {
+      PolyMulMonoComp(q, &pl->m);
+      row = *q;
+      *q = PolyZero();
     }
+
+    GeobucketInsert(&pq, &row);
+    p->list = pl->tail;
+    MonoDestroy(&pl->m);
+    free(pl);
   }
 
-  return pq;
+  *p = PolyZero();
+  return GeobucketFinalise(&pq);
 }
 
 Poly PolyNeg(const Poly* p)
@@ -90,6 +164,15 @@ Poly PolyNeg(const Poly* p)
   return PolyMulCoeff(p, -1);
 }
 
+Poly PolyNegOwn(Poly* p)
+{
+  Poly neg = *p;
+
+  PolyNegComp(&neg);
+  *p = PolyZero();
+  return neg;
+}
+
 Poly PolySub(const Poly* p, const Poly* q)
 {
   /* nq := -q; nq += p <---> nq := (-q) + p */
@@ -99,6 +182,12 @@ Poly PolySub(const Poly* p, const Poly* q)
   return nq;
 }
 
+Poly PolySubOwn(Poly* p, Poly* q)
+{
+  PolyNegComp(q);
+  return PolyAddOwn(p, q);
+}
+
 /**
  * Prosta funkcyjka licząca maksimum dwu wykładników.
  * @param[in] a : @f$ a @f$
@@ -199,88 +288,266 @@ static poly_coeff_t QuickPow(poly_coeff_t a, poly_coeff_t n)
 }
 
 Poly PolyAt(const Poly* p, poly_coeff_t x)
+{
+  Poly cpy = PolyClone(p);
+  return PolyAtOwn(&cpy, x);
+}
+
+Poly PolyAtOwn(Poly* p, poly_coeff_t x)
 {
   /* zamieniam wszystkie x_0 na x i potęguję je przez odpowiednie wykładniki.
    * sumuję m->p * x^n -- powstaje mi suma kumulatywna wielomianów wielu */
-  Poly res = PolyZero();
-  Poly mul;
-  poly_coeff_t coeff;
+  Geobucket res;
+  MonoList* pl;
+
+  GeobucketInit(&res);
+
+  /* współczynniki jednomianów są mnożone w miejscu i wprost włączane do
+   * sumy, a komórki listy p zwalniane */
+  while ((pl = p->list)) {
+    p->list = pl->tail;
+    PolyMulCoeffComp(&pl->m.p, QuickPow(x, pl->m.exp));
+    GeobucketInsert(&res, &pl->m.p);
+    free(pl);
+  }
+
+  /* dla wielomianu stałego akumulator jest pusty, a wynikiem jest p */
+  GeobucketInsert(&res, p);
+  return GeobucketFinalise(&res);
+}
+
+/**
+ * Wartość w punkcie @p x wielomianu jednej zmiennej o stałych współczynnikach,
+ * liczona schematem Hornera. Kolejne przerwy między wykładnikami listy
+ * pokonywane są szybkim potęgowaniem.
+ * @param[in] head : lista jednomianów o stałych współczynnikach
+ * @param[in] x : wartość argumentu
+ * @return wartość wielomianu w punkcie @p x
+ */
+static poly_coeff_t MonoListHorner(const MonoList* head, poly_coeff_t x)
+{
+  poly_coeff_t acc = 0;
+  poly_exp_t next;
+
+  for (; head; head = head->tail) {
+    next = head->tail ? head->tail->m.exp : 0;
+    acc += head->m.p.coeff;
+    acc *= QuickPow(x, head->m.exp - next);
+  }
+
+  return acc;
+}
+
+/**
+ * Podstawienie @p x pod zmienną o indeksie @p idx w wielomianie @p p,
+ * wykonywane w miejscu.
+ * @param[in,out] p : wielomian
+ * @param[in] idx : indeks zmiennej
+ * @param[in] x : wartość argumentu
+ */
+static void PolyAtVarComp(Poly* p, size_t idx, poly_coeff_t x)
+{
+  MonoList** tracer = &p->list;
+  MonoList* tmp;
+  poly_coeff_t val;
 
   if (PolyIsCoeff(p))
-    return PolyClone(p);
+    return;
 
-  for (MonoList* pl = p->list; pl; pl = pl->tail) {
-    coeff = QuickPow(x, pl->m.exp);
-    mul = PolyMulCoeff(&pl->m.p, coeff);
-    PolyIncorporate(&res, &mul);
+  if (idx == 0) {
+    if (MonoListIsFlat(p->list)) {
+      val = MonoListHorner(p->list, x);
+      PolyDestroy(p);
+      *p = PolyFromCoeff(val);
+    } else {
+      *p = PolyAtOwn(p, x);
+    }
+
+    return;
+  }
+
+  /* zmienne zewnętrzne pozostają nietknięte, podstawiamy we współczynnikach */
+  while (*tracer) {
+    PolyAtVarComp(&(*tracer)->m.p, idx - 1, x);
+
+    if (PolyIsZero(&(*tracer)->m.p)) {
+      tmp = *tracer;
+      *tracer = tmp->tail;
+      free(tmp);
+    } else {
+      tracer = &(*tracer)->tail;
+    }
   }
 
-  return res;
+  if (PolyIsPseudoCoeff(p->list))
+    Decoeffise(p);
+}
+
+Poly PolyAtVar(const Poly* p, size_t idx, poly_coeff_t x)
+{
+  Poly cpy = PolyClone(p);
+  return PolyAtVarOwn(&cpy, idx, x);
+}
+
+Poly PolyAtVarOwn(Poly* p, size_t idx, poly_coeff_t x)
+{
+  Poly at = *p;
+
+  PolyAtVarComp(&at, idx, x);
+  *p = PolyZero();
+  return at;
 }
 
 /**
- * Czy wielomian ma wiele jednomianów.
- * Mała pomocnicza funkcyjka dla @ref PolyCompose -- sprawdza czy wielomian @p p
- * ma ''wiele'' jednomianów tj. czy użycie heurstyki liczenia optymalnych potęg
- * użyciu tablicy potęg (patrz @ref PolyPowTable) jest uzasadnione.
- *
- * _Uwaga_: przyjmuję, że wielomian ma _wiele_ jednomianów gdy ma ich niemniej
- * niż 2. Próg ten został określony doświadczalnie.
- * @param[in] p : wielomian, który chcemy składać
- * @return czy ma wiele jednomianów */
-static bool PolyHasManyMonos(const Poly* p)
+ * Czy podstawiając @p q do @p p opłaca się liczyć tablicę potęg
+ * (patrz @ref PolyPowTable). Tablica kosztuje tyle podniesień do kwadratu,
+ * ile bitów ma stopień @p p, bez jednego, a osobne potęgowanie do każdego
+ * wykładnika -- @ref PolyShape::squarings; tablica musi wygrywać o
+ * @ref PolyTuning::table_bias. Potęgi jednomianu @p q liczone są bez mnożenia
+ * list, więc dla niego tablica nic nie daje.
+ * @param[in] p : wielomian, który chcemy składać, niebędący współczynnikiem
+ * @param[in] q : wielomian podstawiany, niebędący współczynnikiem
+ * @return czy użyć tablicy potęg */
+static bool PolyComposeUsesTable(const Poly* p, const Poly* q)
 {
-  return p->list && p->list->tail && p->list->tail->tail;
+  PolyShape shape;
+  size_t table = 0;
+
+  if (!q->list->tail)
+    return false;
+
+  PolyShapeOf(p, 1, &shape);
+
+  for (poly_exp_t n = shape.deg[0]; n > 1; n /= 2)
+    ++table;
+
+  return (long long)shape.squarings > (long long)table +
+         PolyTuningGet()->table_bias;
 }
 
-Poly PolyCompose(const Poly* p, size_t k, const Poly* q)
+/**
+ * Tablica potęg @p q dla @ref PolyComposeEat, liczona dopiero przy pierwszej
+ * potrzebie. Jednomiany idą malejąco, więc pierwszy, dla którego potęga jest
+ * potrzebna, wyznacza jej największy wykładnik -- jednomiany, których
+ * współczynniki po złożeniu się zerują, nie kosztują wtedy nic.
+ * @param[in,out] powers : tablica bądź `NULL`, jeśli jeszcze jej nie ma
+ * @param[in,out] count : rozmiar tablicy
+ * @param[in] pl : jednomian, dla którego potrzebna jest potęga
+ * @param[in] q : wielomian podstawiany
+ * @return tablica potęg
+ */
+static const Poly* ComposePowers(Poly** powers, size_t* count,
+                                 MonoList* pl, const Poly* q)
+{
+  if (!*powers)
+    *powers = PolyPowTable(&(Poly) {.coeff = 0, .list = pl}, q, count);
+
+  return *powers;
+}
+
+/**
+ * Złożenie wielomianów tak jak w @ref PolyCompose, które przejmuje na własność
+ * jedynie @p p. Wielomiany z @p q są podstawiane wielokrotnie, więc pozostają
+ * nienaruszone. Jeśli @p trunc jest ustawione, to wynik jest obcinany do
+ * stopnia @p deg, a wszystkie iloczyny i potęgi pośrednie liczone są od razu
+ * w wersji obciętej.
+ * @param[in,out] p : wielomian do podstawiania weń składowych
+ * @param[in] k : liczba wielomianów do złożenia z @p p
+ * @param[in] q : tablica wielomianów do podstawienia
+ * @param[in] trunc : czy obcinać wynik
+ * @param[in] deg : ograniczenie stopnia przy obcinaniu
+ * @return efekt złożenia @p p z wielomianami z @p q
+ */
+static Poly PolyComposeEat(Poly* p, size_t k, const Poly* q, bool trunc,
+                           poly_exp_t deg)
 {
   Poly* powers = NULL;
-  bool tbl_heuristic = PolyHasManyMonos(p) && k > 0 && !PolyIsCoeff(q);
-  size_t count;
+  bool tbl_heuristic = !PolyIsCoeff(p) && k > 0 && !PolyIsCoeff(q) &&
+                       !trunc && PolyComposeUsesTable(p, q);
+  size_t count = 0;
   Poly subcomposee;
   Poly composee = PolyZero();
+  Geobucket sum;
+  MonoList* pl;
   Poly pow;
   Poly mul;
 
-  if (PolyIsCoeff(p))
-    return PolyClone(p);
-
-  if (k > 0) {
-    if (tbl_heuristic)
-      powers = PolyPowTable(p, q, &count);
+  if (PolyIsCoeff(p)) {
+    composee = trunc && deg < 0 ? PolyZero() : *p;
+    *p = PolyZero();
+    return composee;
+  }
 
-    for (MonoList* pl = p->list; pl; pl = pl->tail) {
-      subcomposee = PolyCompose(&pl->m.p, k - 1, q + 1);
+  GeobucketInit(&sum);
 
-      if (PolyIsZero(&subcomposee))
-        continue;
+  while ((pl = p->list)) {
+    p->list = pl->tail;
 
-      if (PolyIsCoeff(q))
-        pow = PolyFromCoeff(QuickPow(q->coeff, pl->m.exp));
-      else if (tbl_heuristic)
-        pow = PolyGetPow(powers, pl->m.exp);
+    if (k == 0) {
+      if (pl->m.exp == 0)
+        composee = PolyComposeEat(&pl->m.p, k, q, trunc, deg);
       else
-        pow = PolyPow(q, pl->m.exp);
+        MonoDestroy(&pl->m);
+    } else {
+      subcomposee = PolyComposeEat(&pl->m.p, k - 1, q + 1, trunc, deg);
+
+      if (!PolyIsZero(&subcomposee)) {
+        if (PolyIsCoeff(q))
+          pow = PolyFromCoeff(QuickPow(q->coeff, pl->m.exp));
+        else if (trunc)
+          pow = PolyPowTrunc(q, pl->m.exp, deg);
+        else if (tbl_heuristic)
+          pow = PolyGetPow(ComposePowers(&powers, &count, pl, q), pl->m.exp);
+        else
+          pow = PolyPow(q, pl->m.exp);
+
+        if (trunc) {
+          mul = PolyMulTrunc(&pow, &subcomposee, deg);
+          PolyDestroy(&pow);
+          PolyDestroy(&subcomposee);
+        } else {
+          mul = PolyMulOwn(&pow, &subcomposee);
+        }
+
+        GeobucketInsert(&sum, &mul);
+      }
+    }
 
+    free(pl);
+  }
 
-      mul = PolyMul(&pow, &subcomposee);
-      PolyIncorporate(&composee, &mul);
-      PolyDestroy(&subcomposee);
-      PolyDestroy(&pow);
-    }
+  if (k > 0)
+    composee = GeobucketFinalise(&sum);
 
-    if (tbl_heuristic) {
-      for (size_t i = 0; i < count; ++i)
-        PolyDestroy(powers + i);
+  if (powers) {
+    for (size_t i = 0; i < count; ++i)
+      PolyDestroy(powers + i);
 
-      free(powers);
-    }
-  } else if (k == 0) {
-    for (MonoList* pl = p->list; pl; pl = pl->tail) {
-      if (pl->m.exp == 0)
-        composee = PolyCompose(&pl->m.p, k, q);
-    }
+    free(powers);
+  }
+
+  return composee;
+}
+
+Poly PolyCompose(const Poly* p, size_t k, const Poly* q)
+{
+  Poly cpy = PolyClone(p);
+  return PolyComposeEat(&cpy, k, q, false, 0);
+}
+
+Poly PolyComposeTrunc(const Poly* p, size_t k, const Poly* q, poly_exp_t deg)
+{
+  Poly cpy = PolyClone(p);
+  return PolyComposeEat(&cpy, k, q, true, deg);
+}
+
+Poly PolyComposeOwn(Poly* p, size_t k, Poly q[])
+{
+  Poly composee = PolyComposeEat(p, k, q, false, 0);
+
+  for (size_t i = 0; i < k; ++i) {
+    PolyDestroy(q + i);
+    q[i] = PolyZero();
   }
 
   return composee;
@@ -309,12 +576,10 @@ Poly PolyOwnMonos(size_t count, Mono monos[])
 {
   Poly p;
 
-  if (!count || !monos) {
+  if (!count || !monos)
     p = PolyZero();
-  } else {
-    qsort(monos, count, sizeof(Mono), MonoCmpQsort);
-    p = PolyAddMonos(count, monos);
-  }
+  else
+    p = PolyFromMonos(count, monos);
 
   free(monos);
   return p;
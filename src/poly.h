@@ -167,6 +167,15 @@ static inline Mono MonoClone(const Mono* m)
  */
 Poly PolyAdd(const Poly* p, const Poly* q);
 
+/**
+ * Dodaje dwa wielomiany, przejmując je na własność. Wynik zbudowany jest
+ * z jednomianów @p p i @p q, a w ich miejsce wstawiane są wielomiany zerowe.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in,out] q : wielomian @f$q@f$
+ * @return @f$p + q@f$
+ */
+Poly PolyAddOwn(Poly* p, Poly* q);
+
 /**
  * Sumuje tablicę jednomianów i tworzy z nich wielomian.
  * Przejmuje na własność zawartość tablicy @p monos.
@@ -207,6 +216,16 @@ Poly PolyCloneMonos(size_t count, const Mono monos[]);
  */
 Poly PolyMul(const Poly* p, const Poly* q);
 
+/**
+ * Mnoży dwa wielomiany, przejmując je na własność. Ostatni z wierszy iloczynu
+ * powstaje w miejscu, na jednomianach @p q. W miejsce argumentów wstawiane są
+ * wielomiany zerowe.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in,out] q : wielomian @f$q@f$
+ * @return @f$p \cdot q@f$
+ */
+Poly PolyMulOwn(Poly* p, Poly* q);
+
 /**
  * Zwraca przeciwny wielomian.
  * @param[in] p : wielomian @f$p@f$
@@ -214,6 +233,14 @@ Poly PolyMul(const Poly* p, const Poly* q);
  */
 Poly PolyNeg(const Poly* p);
 
+/**
+ * Zwraca przeciwny wielomian, liczony w miejscu. Przejmuje @p p na własność
+ * i wstawia w jego miejsce wielomian zerowy.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @return @f$-p@f$
+ */
+Poly PolyNegOwn(Poly* p);
+
 /**
  * Odejmuje wielomian od wielomianu.
  * @param[in] p : wielomian @f$p@f$
@@ -222,6 +249,15 @@ Poly PolyNeg(const Poly* p);
  */
 Poly PolySub(const Poly* p, const Poly* q);
 
+/**
+ * Odejmuje wielomian od wielomianu, przejmując oba na własność. W miejsce
+ * argumentów wstawiane są wielomiany zerowe.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in,out] q : wielomian @f$q@f$
+ * @return @f$p - q@f$
+ */
+Poly PolySubOwn(Poly* p, Poly* q);
+
 /**
  * Zwraca stopień wielomianu ze względu na zadaną zmienną (-1 dla wielomianu
  * tożsamościowo równego zeru). Zmienne indeksowane są od 0.
@@ -262,6 +298,42 @@ bool PolyIsEq(const Poly* p, const Poly* q);
  */
 Poly PolyAt(const Poly* p, poly_coeff_t x);
 
+/**
+ * Wylicza wartość wielomianu w punkcie @p x tak jak @ref PolyAt, ale
+ * przejmuje @p p na własność i buduje wynik z jego jednomianów. W miejsce
+ * @p p wstawiany jest wielomian zerowy.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] x : wartość argumentu @f$x@f$
+ * @return @f$p(x, x_0, x_1, \ldots)@f$
+ */
+Poly PolyAtOwn(Poly* p, poly_coeff_t x);
+
+/**
+ * Wylicza wartość wielomianu w punkcie @p x względem zmiennej o indeksie
+ * @p idx. Schodzi do współczynników będących wielomianami zmiennej
+ * @f$x_{idx}@f$ i tam dokonuje podstawienia (dla stałych współczynników
+ * schematem Hornera), pozostawiając strukturę zewnętrznych zmiennych bez
+ * zmian. Indeksy zmiennych dalszych niż @p idx zmniejszają się o jeden.
+ * Formalnie dla wielomianu @f$p(x_0, \ldots, x_{idx}, x_{idx+1}, \ldots)@f$
+ * wynikiem jest @f$p(x_0, \ldots, x_{idx-1}, x, x_{idx}, \ldots)@f$.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] idx : indeks zmiennej
+ * @param[in] x : wartość argumentu @f$x@f$
+ * @return wielomian po podstawieniu
+ */
+Poly PolyAtVar(const Poly* p, size_t idx, poly_coeff_t x);
+
+/**
+ * Wylicza wartość wielomianu w punkcie @p x względem zmiennej o indeksie
+ * @p idx tak jak @ref PolyAtVar, ale przejmuje @p p na własność i dokonuje
+ * podstawienia w miejscu. W miejsce @p p wstawiany jest wielomian zerowy.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] idx : indeks zmiennej
+ * @param[in] x : wartość argumentu @f$x@f$
+ * @return wielomian po podstawieniu
+ */
+Poly PolyAtVarOwn(Poly* p, size_t idx, poly_coeff_t x);
+
 /**
  * Złożenie wielomianu @p p z @p k wielomianem @p q i kolejnymi w tablicy.
  * Jeśli oryginalny wielomian miał postać @f$p(x_0, x_1,\ldots, x_{l-1})@f$, to
@@ -284,4 +356,27 @@ Poly PolyAt(const Poly* p, poly_coeff_t x);
  */
 Poly PolyCompose(const Poly* p, size_t k, const Poly* q);
 
+/**
+ * Złożenie wielomianów tak jak w @ref PolyCompose, ale przejmujące na
+ * własność zarówno @p p, jak i @p k wielomianów z tablicy @p q. W miejsce
+ * wszystkich argumentów wstawiane są wielomiany zerowe.
+ * @param[in,out] p : wielomian do podstawiania weń składowych
+ * @param[in] k : liczba wielomianów do złożenia z @p p
+ * @param[in,out] q : tablica wielomianów do podstawienia
+ * @return efekt złożenia @p p z wielomianami z @p q
+ */
+Poly PolyComposeOwn(Poly* p, size_t k, Poly q[]);
+
+/**
+ * Złożenie wielomianów tak jak w @ref PolyCompose, obcięte do stopnia @p deg
+ * (jak dla szeregów potęgowych). Jednomiany stopnia większego niż @p deg nie są
+ * wyliczane już w potęgach i iloczynach pośrednich.
+ * @param[in] p : wielomian do podstawiania weń składowych
+ * @param[in] k : liczba wielomianów do złożenia z @p p
+ * @param[in] q : tablica wielomianów do podstawienia
+ * @param[in] deg : ograniczenie stopnia wyniku
+ * @return efekt złożenia @p p z wielomianami z @p q obcięty do stopnia @p deg
+ */
+Poly PolyComposeTrunc(const Poly* p, size_t k, const Poly* q, poly_exp_t deg);
+
 #endif /* __POLY_H__ */
@@ -0,0 +1,977 @@
+/** @file
+  Implementacja binarnego zapisu i odczytu wielomianów z pliku poly_io.h.
+
+  @author Grzegorz Cichosz <g.cichosz@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date czerwiec 2021
+*/
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "poly.h"
+#include "poly_lib.h"
+#include "poly_io.h"
+
+/** Początkowa pojemność stosu poziomów przy przechodzeniu wielomianu. */
+#define IO_FRAMES_INIT_SIZE 16
+/** Mnożnik powiększania stosu poziomów. */
+#define IO_FRAMES_RESIZE 2
+/** Najdłuższy varint 64-bitowej liczby. */
+#define VARINT_MAX_LEN 10
+/** Najdłuższa linia profilu progów. */
+#define TUNING_LINE_SIZE 256
+
+/**
+ * Sprawdzian powodzenia (m)allokacyjnego.
+ */
+#define CHECK_PTR(p)                            \
+  do {                                          \
+    if (!p) {                                   \
+      exit(1);                                  \
+    }                                           \
+  } while (0)
+
+/**
+ * Poziom przechodzenia wielomianu: lista, po której idziemy, i wykładnik
+ * ostatniego jej jednomianu (do kodowania różnicowego).
+ */
+struct IoFrame {
+  MonoList* node;               /**< bieżący jednomian (przy zapisie) */
+  MonoList** tracer;            /**< miejsce na następny węzeł (przy odczycie) */
+  size_t left;                  /**< ile jednomianów poziomu zostało */
+  size_t count;                 /**< ile jednomianów ma poziom (przy odczycie)
+                                     bądź ile już zapisano (przy zapisie) */
+  poly_exp_t prev;              /**< wykładnik poprzedniego jednomianu */
+};
+
+/**
+ * Stos poziomów przechodzenia wielomianu.
+ */
+struct IoStack {
+  struct IoFrame* frames;       /**< poziomy */
+  size_t depth;                 /**< liczba poziomów */
+  size_t size;                  /**< pojemność */
+};
+
+/**
+ * Odłożenie pustego poziomu na stos.
+ * @param[in,out] s : stos
+ * @return nowy poziom
+ */
+static struct IoFrame* IoStackPush(struct IoStack* s)
+{
+  if (s->depth == s->size) {
+    s->size = s->size ? s->size * IO_FRAMES_RESIZE : IO_FRAMES_INIT_SIZE;
+    s->frames = realloc(s->frames, s->size * sizeof(struct IoFrame));
+    CHECK_PTR(s->frames);
+  }
+
+  return s->frames + s->depth++;
+}
+
+/**
+ * Zapis liczby jako varint -- po siedem bitów na bajt, od najmłodszych,
+ * z najstarszym bitem mówiącym, czy liczba trwa dalej.
+ * @param[out] out : miejsce zapisu bądź `NULL`, jeśli tylko liczymy długość
+ * @param[in] v : liczba
+ * @return liczba zapisanych bajtów
+ */
+static size_t PutVarint(unsigned char* out, uint64_t v)
+{
+  size_t n = 0;
+
+  for (; v >= 0x80; v >>= 7, ++n) {
+    if (out)
+      out[n] = (v & 0x7f) | 0x80;
+  }
+
+  if (out)
+    out[n] = v;
+
+  return n + 1;
+}
+
+/**
+ * Odczyt varintu.
+ * @param[in] buf : zapis
+ * @param[in] len : długość zapisu
+ * @param[in,out] pos : pozycja w zapisie
+ * @param[out] v : odczytana liczba
+ * @return czy odczytano poprawny varint
+ */
+static bool GetVarint(const unsigned char* buf, size_t len, size_t* pos,
+                      uint64_t* v)
+{
+  uint64_t acc = 0;
+
+  for (size_t n = 0; n < VARINT_MAX_LEN && *pos < len; ++n) {
+    unsigned char b = buf[(*pos)++];
+
+    /* dziesiąty bajt może nieść już tylko jeden bit */
+    if (n == VARINT_MAX_LEN - 1 && b > 1)
+      return false;
+
+    acc |= (uint64_t)(b & 0x7f) << (7 * n);
+
+    if (!(b & 0x80)) {
+      *v = acc;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/**
+ * Kodowanie zigzag: liczby o małej wartości bezwzględnej dają małe varinty.
+ * @param[in] c : współczynnik
+ * @return liczba nieujemna
+ */
+static uint64_t ZigZag(poly_coeff_t c)
+{
+  return ((uint64_t)c << 1) ^ (c < 0 ? UINT64_MAX : 0);
+}
+
+/**
+ * Odwrotność @ref ZigZag.
+ * @param[in] v : liczba nieujemna
+ * @return współczynnik
+ */
+static poly_coeff_t UnZigZag(uint64_t v)
+{
+  uint64_t u = (v >> 1) ^ (v & 1 ? UINT64_MAX : 0);
+
+  return u <= LONG_MAX ? (poly_coeff_t)u : -(poly_coeff_t)(UINT64_MAX - u) - 1;
+}
+
+/**
+ * Zapis wielomianu bez nagłówka, iteracyjnie w porządku prefiksowym.
+ * @param[in] p : wielomian
+ * @param[out] out : miejsce zapisu bądź `NULL`, jeśli tylko liczymy długość
+ * @return liczba zapisanych bajtów
+ */
+static size_t PolyEncode(const Poly* p, unsigned char* out)
+{
+  struct IoStack s = {NULL, 0, 0};
+  struct IoFrame* f;
+  const Poly* q = p;
+  MonoList* node;
+  uint64_t delta;
+  size_t n = 0;
+
+  for (;;) {
+    /* zapis wielomianu q: stałej od razu, a listy przez nowy poziom */
+    if (PolyIsCoeff(q)) {
+      n += PutVarint(out ? out + n : NULL, 0);
+      n += PutVarint(out ? out + n : NULL, ZigZag(q->coeff));
+    } else {
+      n += PutVarint(out ? out + n : NULL, MonoListLength(q->list));
+      f = IoStackPush(&s);
+      f->node = q->list;
+      f->count = 0;
+    }
+
+    while (s.depth > 0 && !s.frames[s.depth - 1].node)
+      --s.depth;
+
+    if (s.depth == 0)
+      break;
+
+    /* wykładnik następnego jednomianu, a potem jego współczynnik */
+    f = s.frames + s.depth - 1;
+    node = f->node;
+    delta = f->count++ ? (uint64_t)(f->prev - node->m.exp - 1)
+                     : (uint64_t)node->m.exp;
+    n += PutVarint(out ? out + n : NULL, delta);
+    f->prev = node->m.exp;
+    f->node = node->tail;
+    q = &node->m.p;
+  }
+
+  free(s.frames);
+  return n;
+}
+
+/**
+ * Zapis nagłówka: sygnatury i bajtu wersji.
+ * @param[out] buf : miejsce zapisu
+ * @param[in] magic : sygnatura
+ */
+static void PutHeader(unsigned char* buf, const char* magic)
+{
+  memcpy(buf, magic, POLY_IO_HEADER_SIZE - 1);
+  buf[POLY_IO_HEADER_SIZE - 1] = POLY_IO_VERSION;
+}
+
+/**
+ * Sprawdzenie nagłówka.
+ * @param[in] buf : zapis
+ * @param[in] len : długość zapisu
+ * @param[in] magic : oczekiwana sygnatura
+ * @return czy nagłówek jest poprawny
+ */
+static bool HeaderOk(const unsigned char* buf, size_t len, const char* magic)
+{
+  return len >= POLY_IO_HEADER_SIZE &&
+         memcmp(buf, magic, POLY_IO_HEADER_SIZE - 1) == 0 &&
+         buf[POLY_IO_HEADER_SIZE - 1] == POLY_IO_VERSION;
+}
+
+unsigned char* PolySerialize(const Poly* p, size_t* len)
+{
+  unsigned char* buf;
+
+  *len = POLY_IO_HEADER_SIZE + PolyEncode(p, NULL);
+  buf = malloc(*len);
+  CHECK_PTR(buf);
+
+  PutHeader(buf, POLY_IO_MAGIC);
+  PolyEncode(p, buf + POLY_IO_HEADER_SIZE);
+
+  return buf;
+}
+
+/**
+ * Odczyt jednego wielomianu od pozycji @p pos jednym przebiegiem.
+ * @param[in] buf : zapis
+ * @param[in] len : długość zapisu
+ * @param[in,out] pos : pozycja w zapisie, po odczycie za wielomianem
+ * @param[out] p : odczytany wielomian
+ * @return czy zapis wielomianu był poprawny
+ */
+static bool PolyDecode(const unsigned char* buf, size_t len, size_t* pos,
+                       Poly* p)
+{
+  struct IoStack s = {NULL, 0, 0};
+  struct IoFrame* f = NULL;
+  Poly root = PolyZero();
+  Poly* q = &root;
+  MonoList* node;
+  uint64_t v;
+  bool ok = false;
+
+  for (;;) {
+    /* odczyt wielomianu q -- stałej bądź nagłówka listy */
+    if (!GetVarint(buf, len, pos, &v))
+      break;
+
+    if (v == 0) {
+      if (!GetVarint(buf, len, pos, &v))
+        break;
+
+      q->coeff = UnZigZag(v);
+
+      /* w postaci kanonicznej jednomian nie ma zerowego współczynnika, a lista
+       * nie składa się z samego jednomianu stałego */
+      if (s.depth > 0 && (q->coeff == 0 || (f->count == 1 && f->prev == 0)))
+        break;
+    } else {
+      f = IoStackPush(&s);
+      f->tracer = &q->list;
+      f->left = v;
+      f->count = v;
+    }
+
+    while (s.depth > 0 && s.frames[s.depth - 1].left == 0)
+      --s.depth;
+
+    if (s.depth == 0) {
+      ok = true;
+      break;
+    }
+
+    /* nowy jednomian -- od razu wpięty w listę, więc w razie błędu zwolni go
+     * usunięcie całości */
+    f = s.frames + s.depth - 1;
+
+    if (!GetVarint(buf, len, pos, &v))
+      break;
+
+    if (f->left == f->count ? v > INT_MAX : v >= (uint64_t)f->prev)
+      break;
+
+    node = malloc(sizeof(MonoList));
+    CHECK_PTR(node);
+    node->tail = NULL;
+    node->m.p = PolyZero();
+    node->m.exp = f->left == f->count ? (poly_exp_t)v
+                                      : f->prev - 1 - (poly_exp_t)v;
+    *f->tracer = node;
+    f->tracer = &node->tail;
+    f->prev = node->m.exp;
+    --f->left;
+    q = &node->m.p;
+  }
+
+  free(s.frames);
+
+  if (!ok) {
+    PolyDestroy(&root);
+    return false;
+  }
+
+  *p = root;
+  return true;
+}
+
+bool PolyDeserialize(const unsigned char* buf, size_t len, Poly* p)
+{
+  size_t pos = POLY_IO_HEADER_SIZE;
+
+  if (!HeaderOk(buf, len, POLY_IO_MAGIC) || !PolyDecode(buf, len, &pos, p))
+    return false;
+
+  if (pos != len) {
+    PolyDestroy(p);
+    return false;
+  }
+
+  return true;
+}
+
+unsigned char* PolyArraySerialize(size_t count, const Poly polys[],
+                                  size_t* len)
+{
+  unsigned char* buf;
+  size_t n = POLY_IO_HEADER_SIZE + PutVarint(NULL, count);
+
+  for (size_t i = 0; i < count; ++i)
+    n += PolyEncode(polys + i, NULL);
+
+  *len = n;
+  buf = malloc(n);
+  CHECK_PTR(buf);
+
+  PutHeader(buf, POLY_STACK_MAGIC);
+  n = POLY_IO_HEADER_SIZE + PutVarint(buf + POLY_IO_HEADER_SIZE, count);
+
+  for (size_t i = 0; i < count; ++i)
+    n += PolyEncode(polys + i, buf + n);
+
+  return buf;
+}
+
+bool PolyArrayDeserialize(const unsigned char* buf, size_t len,
+                          size_t* count, Poly** polys)
+{
+  size_t pos = POLY_IO_HEADER_SIZE;
+  size_t i = 0;
+  uint64_t n;
+
+  /* każdy wielomian zajmuje co najmniej dwa bajty, co ogranicza alokację */
+  if (!HeaderOk(buf, len, POLY_STACK_MAGIC) ||
+      !GetVarint(buf, len, &pos, &n) || n > (len - pos) / 2)
+    return false;
+
+  *polys = malloc((n ? n : 1) * sizeof(Poly));
+  CHECK_PTR(*polys);
+
+  while (i < n && PolyDecode(buf, len, &pos, *polys + i))
+    ++i;
+
+  if (i < n || pos != len) {
+    while (i > 0)
+      PolyDestroy(*polys + --i);
+
+    free(*polys);
+    return false;
+  }
+
+  *count = n;
+  return true;
+}
+
+/**
+ * Zapis bufora do pliku, który zwalniamy.
+ * @param[in] buf : bufor
+ * @param[in] len : długość bufora
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się zapisać
+ */
+static bool WriteFile(unsigned char* buf, size_t len, const char* path)
+{
+  FILE* file = fopen(path, "wb");
+  bool ok = file && fwrite(buf, 1, len, file) == len;
+
+  if (file && fclose(file) != 0)
+    ok = false;
+
+  free(buf);
+  return ok;
+}
+
+/**
+ * Wczytanie całego pliku jednym odczytem do bufora o dokładnej długości.
+ * @param[in] path : ścieżka pliku
+ * @param[out] len : długość pliku
+ * @return bufor do zwolnienia `free` bądź `NULL`, jeśli nie udało się go
+ *         wczytać albo jest krótszy od nagłówka
+ */
+static unsigned char* ReadFile(const char* path, size_t* len)
+{
+  FILE* file = fopen(path, "rb");
+  struct stat st;
+  unsigned char* buf = NULL;
+
+  if (!file)
+    return NULL;
+
+  if (fstat(fileno(file), &st) == 0 && S_ISREG(st.st_mode) &&
+      st.st_size >= POLY_IO_HEADER_SIZE) {
+    buf = malloc(st.st_size);
+    CHECK_PTR(buf);
+    *len = st.st_size;
+
+    if (fread(buf, 1, *len, file) != *len) {
+      free(buf);
+      buf = NULL;
+    }
+  }
+
+  fclose(file);
+  return buf;
+}
+
+bool PolySave(const Poly* p, const char* path)
+{
+  size_t len;
+  unsigned char* buf = PolySerialize(p, &len);
+
+  return WriteFile(buf, len, path);
+}
+
+bool PolyLoad(const char* path, Poly* p)
+{
+  size_t len;
+  unsigned char* buf = ReadFile(path, &len);
+  bool ok = buf && PolyDeserialize(buf, len, p);
+
+  free(buf);
+  return ok;
+}
+
+bool PolyArraySave(size_t count, const Poly polys[], const char* path)
+{
+  size_t len;
+  unsigned char* buf = PolyArraySerialize(count, polys, &len);
+
+  return WriteFile(buf, len, path);
+}
+
+bool PolyArrayLoad(const char* path, size_t* count, Poly** polys)
+{
+  size_t len;
+  unsigned char* buf = ReadFile(path, &len);
+  bool ok = buf && PolyArrayDeserialize(buf, len, count, polys);
+
+  free(buf);
+  return ok;
+}
+
+/**
+ * Długość rekordu listy zapisu zamrożonego: liczba jednomianów, współczynniki,
+ * wykładniki i dopełnienie do ośmiu bajtów.
+ * @param[in] count : liczba jednomianów
+ * @return długość rekordu
+ */
+static size_t FrozenRecordSize(size_t count)
+{
+  return sizeof(uint64_t) + count * sizeof(FrozenEntry) +
+         ((count * sizeof(int32_t) + 7) & ~(size_t)7);
+}
+
+/**
+ * Łączna długość rekordów list wielomianu.
+ * @param[in] p : wielomian
+ * @return długość rekordów
+ */
+static size_t FrozenSize(const Poly* p)
+{
+  size_t n;
+
+  if (PolyIsCoeff(p))
+    return 0;
+
+  n = FrozenRecordSize(MonoListLength(p->list));
+
+  for (MonoList* pl = p->list; pl; pl = pl->tail)
+    n += FrozenSize(&pl->m.p);
+
+  return n;
+}
+
+/**
+ * Zapis współczynnika, a dla listy -- jej rekordu w miejscu @p cursor i za
+ * nim, w porządku prefiksowym, rekordów list jej jednomianów.
+ * @param[in] p : wielomian
+ * @param[out] buf : wyzerowany bufor zapisu
+ * @param[in,out] cursor : miejsce na kolejny rekord
+ * @param[out] e : zapisywany współczynnik
+ */
+static void FrozenWrite(const Poly* p, unsigned char* buf, size_t* cursor,
+                        FrozenEntry* e)
+{
+  FrozenEntry* coeffs;
+  int32_t* exps;
+  size_t count;
+  size_t i = 0;
+
+  if (PolyIsCoeff(p)) {
+    e->coeff = p->coeff;
+    e->list = 0;
+    return;
+  }
+
+  count = MonoListLength(p->list);
+  e->coeff = 0;
+  e->list = *cursor;
+  *(uint64_t*)(buf + *cursor) = count;
+  coeffs = (FrozenEntry*)(buf + *cursor + sizeof(uint64_t));
+  exps = (int32_t*)(coeffs + count);
+  *cursor += FrozenRecordSize(count);
+
+  for (MonoList* pl = p->list; pl; pl = pl->tail, ++i) {
+    exps[i] = pl->m.exp;
+    FrozenWrite(&pl->m.p, buf, cursor, coeffs + i);
+  }
+}
+
+unsigned char* PolyFreeze(const Poly* p, size_t* len)
+{
+  size_t cursor = POLY_FROZEN_HEADER_SIZE + sizeof(FrozenEntry);
+  uint32_t version = POLY_FROZEN_VERSION;
+  unsigned char* buf;
+
+  *len = cursor + FrozenSize(p);
+  /* zerowanie daje dopełnienia rekordów */
+  buf = calloc(*len, 1);
+  CHECK_PTR(buf);
+
+  memcpy(buf, POLY_FROZEN_MAGIC, sizeof(uint32_t));
+  memcpy(buf + sizeof(uint32_t), &version, sizeof(uint32_t));
+  FrozenWrite(p, buf, &cursor, (FrozenEntry*)(buf + POLY_FROZEN_HEADER_SIZE));
+
+  return buf;
+}
+
+/**
+ * Poziom sprawdzania zapisu zamrożonego: lista i jej następny jednomian.
+ */
+struct FrozenFrame {
+  FrozenList l;                 /**< lista */
+  size_t i;                     /**< indeks następnego jednomianu */
+};
+
+/**
+ * Sprawdzenie rekordu listy, który powinien leżeć w miejscu @p cursor.
+ * @param[in] fp : sprawdzany zapis
+ * @param[in] e : współczynnik wskazujący listę
+ * @param[in,out] cursor : miejsce rekordu, a potem następnego
+ * @param[out] l : widok na listę
+ * @return czy rekord jest poprawny
+ */
+static bool FrozenCheckList(const FrozenPoly* fp, const FrozenEntry* e,
+                            size_t* cursor, FrozenList* l)
+{
+  size_t left = fp->len - *cursor;
+  uint64_t count;
+
+  /* każdy jednomian zajmuje w rekordzie co najmniej 20 bajtów */
+  if (e->coeff != 0 || e->list != *cursor || left < sizeof(uint64_t))
+    return false;
+
+  count = *(const uint64_t*)(fp->base + *cursor);
+
+  if (count == 0 ||
+      count > (left - sizeof(uint64_t)) /
+              (sizeof(FrozenEntry) + sizeof(int32_t)) ||
+      FrozenRecordSize(count) > left)
+    return false;
+
+  *l = FrozenGetList(fp, e);
+  *cursor += FrozenRecordSize(count);
+
+  /* dopełnienie musi być zerowe, by równe wielomiany miały równe zapisy */
+  if (count % 2 == 1 && l->exps[count] != 0)
+    return false;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (l->exps[i] < 0 || (i > 0 && l->exps[i] >= l->exps[i - 1]))
+      return false;
+  }
+
+  return !(count == 1 && l->exps[0] == 0 && FrozenEntryIsCoeff(l->coeffs));
+}
+
+bool FrozenOpen(const unsigned char* buf, size_t len, FrozenPoly* fp)
+{
+  struct FrozenFrame* frames = NULL;
+  struct FrozenFrame* f;
+  size_t depth = 0;
+  size_t size = 0;
+  size_t cursor = POLY_FROZEN_HEADER_SIZE + sizeof(FrozenEntry);
+  const FrozenEntry* e;
+  uint32_t version;
+  bool ok = false;
+
+  if (len < cursor || (uintptr_t)buf % sizeof(uint64_t) != 0 ||
+      memcmp(buf, POLY_FROZEN_MAGIC, sizeof(uint32_t)) != 0)
+    return false;
+
+  memcpy(&version, buf + sizeof(uint32_t), sizeof(uint32_t));
+
+  if (version != POLY_FROZEN_VERSION)
+    return false;
+
+  fp->base = buf;
+  fp->len = len;
+  e = FrozenRoot(fp);
+
+  if (FrozenEntryIsCoeff(e))
+    return cursor == len;
+
+  for (;;) {
+    /* lista współczynnika e, a potem pierwszy jej jednomian z listą */
+    if (depth == size) {
+      size = size ? size * IO_FRAMES_RESIZE : IO_FRAMES_INIT_SIZE;
+      frames = realloc(frames, size * sizeof(struct FrozenFrame));
+      CHECK_PTR(frames);
+    }
+
+    f = frames + depth++;
+    f->i = 0;
+
+    if (!FrozenCheckList(fp, e, &cursor, &f->l))
+      break;
+
+    for (e = NULL; depth > 0 && !e;) {
+      f = frames + depth - 1;
+
+      if (f->i == f->l.count) {
+        --depth;
+      } else {
+        e = f->l.coeffs + f->i++;
+
+        if (FrozenEntryIsCoeff(e)) {
+          if (e->coeff == 0)
+            break;
+
+          e = NULL;
+        }
+      }
+    }
+
+    if (depth == 0) {
+      ok = cursor == len;
+      break;
+    }
+
+    if (FrozenEntryIsCoeff(e))
+      break;
+  }
+
+  free(frames);
+  return ok;
+}
+
+/**
+ * Stopień współczynnika zamrożonego wielomianu, jak @ref PolyDeg.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] e : współczynnik
+ * @return stopień
+ */
+static poly_exp_t FrozenEntryDeg(const FrozenPoly* fp, const FrozenEntry* e)
+{
+  FrozenList l;
+  poly_exp_t deg = -1;
+  poly_exp_t d;
+
+  if (FrozenEntryIsCoeff(e))
+    return e->coeff == 0 ? -1 : 0;
+
+  l = FrozenGetList(fp, e);
+
+  for (size_t i = 0; i < l.count; ++i) {
+    d = l.exps[i] + FrozenEntryDeg(fp, l.coeffs + i);
+    deg = d > deg ? d : deg;
+  }
+
+  return deg;
+}
+
+poly_exp_t FrozenDeg(const FrozenPoly* fp)
+{
+  return FrozenEntryDeg(fp, FrozenRoot(fp));
+}
+
+/**
+ * Stopień współczynnika zamrożonego wielomianu względem zmiennej, jak
+ * @ref PolyDegBy.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] e : współczynnik
+ * @param[in] idx : indeks zmiennej
+ * @return stopień
+ */
+static poly_exp_t FrozenEntryDegBy(const FrozenPoly* fp, const FrozenEntry* e,
+                                   size_t idx)
+{
+  FrozenList l;
+  poly_exp_t deg = -1;
+  poly_exp_t d;
+
+  if (FrozenEntryIsCoeff(e))
+    return e->coeff == 0 ? -1 : 0;
+
+  l = FrozenGetList(fp, e);
+
+  /* wykładniki są malejące, więc największy stoi pierwszy */
+  if (idx == 0)
+    return l.exps[0];
+
+  for (size_t i = 0; i < l.count; ++i) {
+    d = FrozenEntryDegBy(fp, l.coeffs + i, idx - 1);
+    deg = d > deg ? d : deg;
+  }
+
+  return deg;
+}
+
+poly_exp_t FrozenDegBy(const FrozenPoly* fp, size_t idx)
+{
+  return FrozenEntryDegBy(fp, FrozenRoot(fp), idx);
+}
+
+/**
+ * Równość współczynnika zamrożonego wielomianu ze zwykłym wielomianem.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] e : współczynnik
+ * @param[in] q : wielomian
+ * @return czy są równe
+ */
+static bool FrozenEntryIsEq(const FrozenPoly* fp, const FrozenEntry* e,
+                            const Poly* q)
+{
+  FrozenList l;
+  MonoList* ql = q->list;
+
+  if (FrozenEntryIsCoeff(e) || PolyIsCoeff(q))
+    return FrozenEntryIsCoeff(e) && PolyIsCoeff(q) && e->coeff == q->coeff;
+
+  l = FrozenGetList(fp, e);
+
+  for (size_t i = 0; i < l.count; ++i, ql = ql->tail) {
+    if (!ql || ql->m.exp != l.exps[i] ||
+        !FrozenEntryIsEq(fp, l.coeffs + i, &ql->m.p))
+      return false;
+  }
+
+  return !ql;
+}
+
+bool FrozenIsEq(const FrozenPoly* fp, const Poly* q)
+{
+  return FrozenEntryIsEq(fp, FrozenRoot(fp), q);
+}
+
+bool FrozenIsEqFrozen(const FrozenPoly* fp, const FrozenPoly* fq)
+{
+  return fp->len == fq->len &&
+         memcmp(fp->base + POLY_FROZEN_HEADER_SIZE,
+                fq->base + POLY_FROZEN_HEADER_SIZE,
+                fp->len - POLY_FROZEN_HEADER_SIZE) == 0;
+}
+
+/**
+ * Rozmrożenie współczynnika zamrożonego wielomianu.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] e : współczynnik
+ * @return wielomian
+ */
+static Poly FrozenEntryThaw(const FrozenPoly* fp, const FrozenEntry* e)
+{
+  Poly p = PolyZero();
+  MonoList** tracer = &p.list;
+  FrozenList l;
+  Mono m;
+
+  if (FrozenEntryIsCoeff(e))
+    return PolyFromCoeff(e->coeff);
+
+  l = FrozenGetList(fp, e);
+
+  for (size_t i = 0; i < l.count; ++i) {
+    m.p = FrozenEntryThaw(fp, l.coeffs + i);
+    m.exp = l.exps[i];
+    tracer = MonoListAppend(tracer, &m);
+  }
+
+  return p;
+}
+
+Poly FrozenThaw(const FrozenPoly* fp)
+{
+  return FrozenEntryThaw(fp, FrozenRoot(fp));
+}
+
+/**
+ * Potęgowanie liczb całkowitych z przepełnieniem, jak przy @ref PolyAt.
+ * @param[in] a : podstawa
+ * @param[in] n : nieujemny wykładnik
+ * @return @f$a^n@f$
+ */
+static poly_coeff_t CoeffPow(poly_coeff_t a, poly_coeff_t n)
+{
+  poly_coeff_t b = 1;
+
+  for (; n > 0; n /= 2) {
+    if (n % 2 == 1)
+      b *= a;
+
+    a *= a;
+  }
+
+  return b;
+}
+
+/* stałe współczynniki zbiera schemat Hornera wprost po tablicach zapisu;
+ * rozmrażane są tylko współczynniki będące wielomianami, każdy od razu
+ * przemnożony przez potęgę x i włączony do sumy jak w PolyAtOwn */
+Poly FrozenAt(const FrozenPoly* fp, poly_coeff_t x)
+{
+  const FrozenEntry* root = FrozenRoot(fp);
+  poly_coeff_t acc = 0;
+  poly_exp_t next;
+  Geobucket res;
+  FrozenList l;
+  Poly p;
+
+  if (FrozenEntryIsCoeff(root))
+    return PolyFromCoeff(root->coeff);
+
+  l = FrozenGetList(fp, root);
+  GeobucketInit(&res);
+
+  for (size_t i = 0; i < l.count; ++i) {
+    next = i + 1 < l.count ? l.exps[i + 1] : 0;
+
+    if (FrozenEntryIsCoeff(l.coeffs + i)) {
+      acc += l.coeffs[i].coeff;
+    } else {
+      p = FrozenEntryThaw(fp, l.coeffs + i);
+      PolyMulCoeffComp(&p, CoeffPow(x, l.exps[i]));
+      GeobucketInsert(&res, &p);
+    }
+
+    acc *= CoeffPow(x, l.exps[i] - next);
+  }
+
+  p = PolyFromCoeff(acc);
+  GeobucketInsert(&res, &p);
+  return GeobucketFinalise(&res);
+}
+
+bool PolyFreezeSave(const Poly* p, const char* path)
+{
+  size_t len;
+  unsigned char* buf = PolyFreeze(p, &len);
+
+  return WriteFile(buf, len, path);
+}
+
+bool FrozenMap(const char* path, FrozenPoly* fp)
+{
+  int fd = open(path, O_RDONLY);
+  struct stat st;
+  void* base;
+
+  if (fd < 0)
+    return false;
+
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  /* odwzorowanie trzyma plik i bez otwartego deskryptora */
+  base = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+
+  if (base == MAP_FAILED)
+    return false;
+
+  if (!FrozenOpen(base, st.st_size, fp)) {
+    munmap(base, st.st_size);
+    return false;
+  }
+
+  return true;
+}
+
+void FrozenUnmap(const FrozenPoly* fp)
+{
+  munmap((void*)fp->base, fp->len);
+}
+
+bool PolyTuningSave(const PolyTuning* t, const char* path)
+{
+  FILE* file = fopen(path, "w");
+  bool ok;
+
+  if (!file)
+    return false;
+
+  ok = fprintf(file, "# profil progów wyboru algorytmów (poly_tune)\n"
+               "big_exp %ld\nbig_mul_init %zu\ndense_ratio %lld\n"
+               "table_bias %lld\n", t->big_exp, t->big_mul_init,
+               t->dense_ratio, t->table_bias) > 0;
+  return fclose(file) == 0 && ok;
+}
+
+bool PolyTuningLoad(const char* path, PolyTuning* t)
+{
+  FILE* file = fopen(path, "r");
+  char line[TUNING_LINE_SIZE];
+  char key[TUNING_LINE_SIZE];
+  long long value;
+  char rest;
+  bool ok = file != NULL;
+
+  *t = PolyTuningDefault();
+
+  while (ok && fgets(line, sizeof(line), file)) {
+    if (line[0] == '#' || line[strspn(line, " \t\n")] == '\0')
+      continue;
+
+    if (sscanf(line, "%s %lld %c", key, &value, &rest) != 2)
+      ok = false;
+    else if (strcmp(key, "big_exp") == 0 && value >= 0)
+      t->big_exp = value;
+    else if (strcmp(key, "big_mul_init") == 0 && value > 0 &&
+             value <= POLY_TUNING_INIT_MAX)
+      t->big_mul_init = value;
+    else if (strcmp(key, "dense_ratio") == 0 && value >= 0 &&
+             value <= POLY_TUNING_DENSE_MAX)
+      t->dense_ratio = value;
+    else if (strcmp(key, "table_bias") == 0)
+      t->table_bias = value;
+    else
+      ok = false;
+  }
+
+  if (file) {
+    ok = ok && !ferror(file);
+
+    if (fclose(file) != 0)
+      ok = false;
+  }
+
+  return ok;
+}
@@ -0,0 +1,336 @@
+/** @file
+  Binarny zapis i odczyt wielomianów. Format jest zwięzły -- liczby zapisujemy
+  jako _varinty_ (po siedem bitów na bajt), współczynniki dodatkowo w kodowaniu
+  _zigzag_, a wykładniki jako różnice względem poprzedniego jednomianu listy.
+
+  Zapis zaczyna się nagłówkiem z sygnaturą @ref POLY_IO_MAGIC i numerem wersji
+  @ref POLY_IO_VERSION. Dalej wielomian zapisany jest w porządku prefiksowym:
+  - liczba jednomianów @f$n@f$ (varint), przy czym @f$n = 0@f$ oznacza
+    wielomian stały i następuje po nim współczynnik (zigzag varint),
+  - dla listy @f$n@f$ jednomianów w kolejności malejących wykładników: wykładnik
+    (pierwszy wprost, kolejne jako różnica z poprzednim pomniejszona o jeden),
+    po którym zapisany jest współczynnik jednomianu jako wielomian.
+
+  Obok niego jest format _zamrożony_ (@ref POLY_FROZEN_MAGIC), bez wskaźników:
+  zamiast nich przesunięcia względem początku zapisu, a jednomiany listy leżą w
+  ciągłych tablicach. Plik w tym formacie można odwzorować w pamięci (`mmap`) i
+  od razu na nim liczyć operacje niezmieniające wielomianu. Zapis ma postać:
+  - nagłówek: sygnatura, 32-bitowa wersja i @ref FrozenEntry korzenia,
+  - w porządku prefiksowym rekordy list: liczba jednomianów @f$n@f$ (64 bity),
+    @f$n@f$ współczynników jako @ref FrozenEntry, @f$n@f$ wykładników
+    (32 bity, malejąco) i dopełnienie zerami do wielokrotności ośmiu bajtów.
+
+  Liczby zapisane są w kolejności bajtów maszyny, która plik utworzyła; na
+  maszynie o innej kolejności nie zgodzi się numer wersji.
+
+  @author Grzegorz Cichosz <g.cichosz@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date czerwiec 2021
+*/
+
+#ifndef __POLY_IO_H__
+#define __POLY_IO_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "poly.h"
+#include "poly_lib.h"
+
+/** Sygnatura na początku zapisu binarnego. */
+#define POLY_IO_MAGIC "PLY"
+
+/** Sygnatura na początku zapisu całego stosu wielomianów. */
+#define POLY_STACK_MAGIC "PLS"
+
+/** Wersja formatu zapisu binarnego. */
+#define POLY_IO_VERSION 1
+
+/** Długość nagłówka: sygnatura i bajt wersji. */
+#define POLY_IO_HEADER_SIZE 4
+
+/**
+ * Zapis binarny wielomianu. Bufor alokowany jest raz, dokładnie na potrzebną
+ * długość, i trzeba go zwolnić `free`.
+ * @param[in] p : wielomian
+ * @param[out] len : długość zapisu
+ * @return bufor z zapisem
+ */
+unsigned char* PolySerialize(const Poly* p, size_t* len);
+
+/**
+ * Odczyt wielomianu z zapisu binarnego jednym przebiegiem. Odrzuca zapisy
+ * uszkodzone, ucięte, z nadmiarowymi bajtami bądź niebędące w postaci
+ * kanonicznej (np. z zerowym współczynnikiem jednomianu).
+ * @param[in] buf : zapis
+ * @param[in] len : długość zapisu
+ * @param[out] p : odczytany wielomian
+ * @return czy zapis był poprawny
+ */
+bool PolyDeserialize(const unsigned char* buf, size_t len, Poly* p);
+
+/**
+ * Zapis binarny wielomianu do pliku.
+ * @param[in] p : wielomian
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się zapisać
+ */
+bool PolySave(const Poly* p, const char* path);
+
+/**
+ * Odczyt wielomianu z pliku z zapisem binarnym.
+ * @param[in] path : ścieżka pliku
+ * @param[out] p : odczytany wielomian
+ * @return czy udało się odczytać poprawny zapis
+ */
+bool PolyLoad(const char* path, Poly* p);
+
+/**
+ * Zapis binarny tablicy wielomianów, np. całego stosu kalkulatora. Po
+ * nagłówku z sygnaturą @ref POLY_STACK_MAGIC następuje liczba wielomianów
+ * (varint) i kolejne wielomiany w formacie jak w @ref PolySerialize.
+ * @param[in] count : liczba wielomianów
+ * @param[in] polys : wielomiany
+ * @param[out] len : długość zapisu
+ * @return bufor z zapisem do zwolnienia `free`
+ */
+unsigned char* PolyArraySerialize(size_t count, const Poly polys[],
+                                  size_t* len);
+
+/**
+ * Odczyt tablicy wielomianów jednym przebiegiem, z tymi samymi wymogami co
+ * @ref PolyDeserialize.
+ * @param[in] buf : zapis
+ * @param[in] len : długość zapisu
+ * @param[out] count : liczba wielomianów
+ * @param[out] polys : tablica wielomianów do zwolnienia `free`
+ * @return czy zapis był poprawny
+ */
+bool PolyArrayDeserialize(const unsigned char* buf, size_t len,
+                          size_t* count, Poly** polys);
+
+/**
+ * Zapis binarny tablicy wielomianów do pliku.
+ * @param[in] count : liczba wielomianów
+ * @param[in] polys : wielomiany
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się zapisać
+ */
+bool PolyArraySave(size_t count, const Poly polys[], const char* path);
+
+/**
+ * Odczyt tablicy wielomianów z pliku.
+ * @param[in] path : ścieżka pliku
+ * @param[out] count : liczba wielomianów
+ * @param[out] polys : tablica wielomianów do zwolnienia `free`
+ * @return czy udało się odczytać poprawny zapis
+ */
+bool PolyArrayLoad(const char* path, size_t* count, Poly** polys);
+
+/** Sygnatura na początku zapisu zamrożonego. */
+#define POLY_FROZEN_MAGIC "PLYF"
+
+/** Wersja formatu zamrożonego. */
+#define POLY_FROZEN_VERSION 1
+
+/** Długość nagłówka zapisu zamrożonego bez korzenia: sygnatura i wersja. */
+#define POLY_FROZEN_HEADER_SIZE 8
+
+/**
+ * Współczynnik w zapisie zamrożonym: stała bądź przesunięcie rekordu listy.
+ */
+typedef struct FrozenEntry {
+  int64_t coeff;                /**< współczynnik, jeśli `list == 0`; wpp. 0 */
+  uint64_t list;                /**< przesunięcie rekordu listy bądź 0 */
+} FrozenEntry;
+
+/**
+ * Zamrożony wielomian -- sprawdzony przez @ref FrozenOpen zapis w pamięci.
+ * Zapisu nie posiada; trzeba go utrzymać, póki wielomian jest w użyciu.
+ */
+typedef struct FrozenPoly {
+  const unsigned char* base;    /**< początek zapisu */
+  size_t len;                   /**< długość zapisu */
+} FrozenPoly;
+
+/**
+ * Widok na rekord listy zamrożonego wielomianu.
+ */
+typedef struct FrozenList {
+  size_t count;                 /**< liczba jednomianów */
+  const FrozenEntry* coeffs;    /**< współczynniki jednomianów */
+  const int32_t* exps;          /**< wykładniki, malejąco */
+} FrozenList;
+
+/**
+ * Korzeń zamrożonego wielomianu.
+ * @param[in] fp : zamrożony wielomian
+ * @return współczynnik będący całym wielomianem
+ */
+static inline const FrozenEntry* FrozenRoot(const FrozenPoly* fp)
+{
+  return (const FrozenEntry*)(fp->base + POLY_FROZEN_HEADER_SIZE);
+}
+
+/**
+ * Sprawdzian, czy współczynnik zamrożonego wielomianu jest stałą.
+ * @param[in] e : współczynnik
+ * @return czy to stała
+ */
+static inline bool FrozenEntryIsCoeff(const FrozenEntry* e)
+{
+  return e->list == 0;
+}
+
+/**
+ * Rekord listy współczynnika niebędącego stałą.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] e : współczynnik z listą
+ * @return widok na listę
+ */
+static inline FrozenList FrozenGetList(const FrozenPoly* fp,
+                                       const FrozenEntry* e)
+{
+  const unsigned char* rec = fp->base + e->list;
+  FrozenList l;
+
+  l.count = *(const uint64_t*)rec;
+  l.coeffs = (const FrozenEntry*)(rec + sizeof(uint64_t));
+  l.exps = (const int32_t*)(l.coeffs + l.count);
+  return l;
+}
+
+/**
+ * Zamrożenie wielomianu. Bufor alokowany jest raz, dokładnie na potrzebną
+ * długość, i trzeba go zwolnić `free`.
+ * @param[in] p : wielomian
+ * @param[out] len : długość zapisu
+ * @return bufor z zapisem
+ */
+unsigned char* PolyFreeze(const Poly* p, size_t* len);
+
+/**
+ * Sprawdzenie zapisu zamrożonego jednym przebiegiem. Każda lista musi leżeć
+ * dokładnie tam, gdzie wypada w porządku prefiksowym, więc zapis jest drzewem
+ * bez współdzielenia i bez luk, a wielomian jest w postaci kanonicznej. Bufor
+ * musi być wyrównany do ośmiu bajtów.
+ * @param[in] buf : zapis
+ * @param[in] len : długość zapisu
+ * @param[out] fp : zamrożony wielomian
+ * @return czy zapis był poprawny
+ */
+bool FrozenOpen(const unsigned char* buf, size_t len, FrozenPoly* fp);
+
+/**
+ * Sprawdzian, czy zamrożony wielomian jest stały.
+ * @param[in] fp : zamrożony wielomian
+ * @return czy to stała
+ */
+static inline bool FrozenIsCoeff(const FrozenPoly* fp)
+{
+  return FrozenEntryIsCoeff(FrozenRoot(fp));
+}
+
+/**
+ * Sprawdzian, czy zamrożony wielomian jest zerowy.
+ * @param[in] fp : zamrożony wielomian
+ * @return czy to zero
+ */
+static inline bool FrozenIsZero(const FrozenPoly* fp)
+{
+  return FrozenIsCoeff(fp) && FrozenRoot(fp)->coeff == 0;
+}
+
+/**
+ * Stopień zamrożonego wielomianu, jak @ref PolyDeg.
+ * @param[in] fp : zamrożony wielomian
+ * @return stopień
+ */
+poly_exp_t FrozenDeg(const FrozenPoly* fp);
+
+/**
+ * Stopień zamrożonego wielomianu względem zmiennej, jak @ref PolyDegBy.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] idx : indeks zmiennej
+ * @return stopień
+ */
+poly_exp_t FrozenDegBy(const FrozenPoly* fp, size_t idx);
+
+/**
+ * Równość zamrożonego wielomianu ze zwykłym.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] q : wielomian
+ * @return czy są równe
+ */
+bool FrozenIsEq(const FrozenPoly* fp, const Poly* q);
+
+/**
+ * Równość dwóch zamrożonych wielomianów. Zapis jest wyznaczony jednoznacznie
+ * przez wielomian, więc wystarcza porównanie bajtów.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] fq : zamrożony wielomian
+ * @return czy są równe
+ */
+bool FrozenIsEqFrozen(const FrozenPoly* fp, const FrozenPoly* fq);
+
+/**
+ * Rozmrożenie wielomianu do zwykłej postaci.
+ * @param[in] fp : zamrożony wielomian
+ * @return wielomian
+ */
+Poly FrozenThaw(const FrozenPoly* fp);
+
+/**
+ * Podstawienie wartości pod główną zmienną, jak @ref PolyAt, bez rozmrażania
+ * całego wielomianu: rozmrażane są jedynie te współczynniki najwyższego
+ * poziomu, które same są wielomianami.
+ * @param[in] fp : zamrożony wielomian
+ * @param[in] x : wartość
+ * @return wielomian po podstawieniu
+ */
+Poly FrozenAt(const FrozenPoly* fp, poly_coeff_t x);
+
+/**
+ * Zamrożenie wielomianu do pliku.
+ * @param[in] p : wielomian
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się zapisać
+ */
+bool PolyFreezeSave(const Poly* p, const char* path);
+
+/**
+ * Odwzorowanie w pamięci pliku z zapisem zamrożonym, tylko do odczytu.
+ * Odwzorowanie zwalnia @ref FrozenUnmap.
+ * @param[in] path : ścieżka pliku
+ * @param[out] fp : zamrożony wielomian
+ * @return czy plik zawiera poprawny zapis
+ */
+bool FrozenMap(const char* path, FrozenPoly* fp);
+
+/**
+ * Zwolnienie odwzorowania utworzonego przez @ref FrozenMap.
+ * @param[in] fp : zamrożony wielomian
+ */
+void FrozenUnmap(const FrozenPoly* fp);
+
+/**
+ * Zapis profilu progów wyboru algorytmów. Profil jest tekstowy: każda linia
+ * to nazwa pola @ref PolyTuning i jego wartość, a linie zaczynające się od
+ * `#` są komentarzami.
+ * @param[in] t : progi
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się zapisać
+ */
+bool PolyTuningSave(const PolyTuning* t, const char* path);
+
+/**
+ * Odczyt profilu zapisanego przez @ref PolyTuningSave. Pola, których profil
+ * nie wymienia, mają wartości domyślne.
+ * @param[in] path : ścieżka pliku
+ * @param[out] t : progi
+ * @return czy plik jest poprawnym profilem
+ */
+bool PolyTuningLoad(const char* path, PolyTuning* t);
+
+#endif /* __POLY_IO_H__ */
@@ -8,19 +8,42 @@
 */
 
 #include <stdlib.h>
+#include <limits.h>
 
 #include "poly.h"
 #include "poly_lib.h"
 
 /**
- * Próg stosowania alternatywego mnożenia (@ref PolyMulLong) w potęgowaniu.
- * Wyznaczony quasi-eksperymentalnie.
+ * Domyślny próg stosowania alternatywego mnożenia (@ref PolyMulLong)
+ * w potęgowaniu. Wyznaczony quasi-eksperymentalnie; `poly_tune` mierzy go
+ * na bieżącej maszynie.
  */
 #define BIG_EXP 3000
 /** Współczynnik poszerzania tablicy jednomianów w @ref PolyMulLong */
 #define BIG_MUL_ARRAY_RESIZE 2
-/** Początkowy rozmiar tablicy jednomianów w @ref PolyMulLong. */
+/** Domyślny początkowy rozmiar tablicy jednomianów w @ref PolyMulLong. */
 #define BIG_MUL_ARRAY_INIT_SIZE 16
+/**
+ * Domyślny dopuszczalny stosunek rozpiętości wykładników iloczynu do liczby
+ * iloczynów jednomianów, przy którym mnożenie odbywa się na tablicy
+ * (@ref PolyMulDense).
+ */
+#define DENSE_MUL_SPAN_RATIO 2
+/**
+ * Domyślna przewaga liczby podniesień do kwadratu przy osobnym potęgowaniu,
+ * od której składanie liczy tablicę potęg (@ref PolyPowTable).
+ */
+#define COMPOSE_TABLE_BIAS 0
+/** Iloraz pojemności kolejnych kubełków w @ref Geobucket. */
+#define GEOBUCKET_BASE 4
+
+/** Bieżące progi wyboru algorytmów. */
+static PolyTuning tuning = {
+  .big_exp = BIG_EXP,
+  .big_mul_init = BIG_MUL_ARRAY_INIT_SIZE,
+  .dense_ratio = DENSE_MUL_SPAN_RATIO,
+  .table_bias = COMPOSE_TABLE_BIAS
+};
 
 /**
  * Sprawdzian powodzenia (m)allokacyjnego.
@@ -32,29 +55,77 @@
     }                                           \
   } while (0)
 
+PolyTuning PolyTuningDefault(void)
+{
+  return (PolyTuning) {
+    .big_exp = BIG_EXP,
+    .big_mul_init = BIG_MUL_ARRAY_INIT_SIZE,
+    .dense_ratio = DENSE_MUL_SPAN_RATIO,
+    .table_bias = COMPOSE_TABLE_BIAS
+  };
+}
+
+const PolyTuning* PolyTuningGet(void)
+{
+  return &tuning;
+}
+
+void PolyTuningSet(const PolyTuning* t)
+{
+  assert(t->big_exp >= 0 && t->big_mul_init > 0 && t->dense_ratio >= 0);
+  tuning = *t;
+
+  if (tuning.dense_ratio > POLY_TUNING_DENSE_MAX)
+    tuning.dense_ratio = POLY_TUNING_DENSE_MAX;
+
+  if (tuning.big_mul_init > POLY_TUNING_INIT_MAX)
+    tuning.big_mul_init = POLY_TUNING_INIT_MAX;
+}
+
 void MonoListDestroy(MonoList* head)
 {
-  if (!head)
-    return;
+  MonoList* tail;
 
-  MonoListDestroy(head->tail);
-  MonoDestroy(&head->m);
-  free(head);
+  for (; head; head = tail) {
+    tail = head->tail;
+    MonoDestroy(&head->m);
+    free(head);
+  }
 }
 
-MonoList* MonoListClone(const MonoList* head)
+size_t MonoListLength(const MonoList* head)
 {
-  MonoList* elem;
+  size_t len = 0;
 
-  if (!head)
-    return NULL;
+  for (; head; head = head->tail)
+    ++len;
+
+  return len;
+}
+
+MonoList** MonoListAppend(MonoList** tracer, const Mono* m)
+{
+  assert(!*tracer);
+  *tracer = malloc(sizeof(MonoList));
+  CHECK_PTR(*tracer);
+  (*tracer)->m = *m;
+  (*tracer)->tail = NULL;
+  return &(*tracer)->tail;
+}
 
-  elem = malloc(sizeof(MonoList));
-  CHECK_PTR(elem);
-  elem->m = MonoClone(&head->m);
-  elem->tail = MonoListClone(head->tail);
+MonoList* MonoListClone(const MonoList* head)
+{
+  MonoList* cpy = NULL;
+  MonoList** tracer = &cpy;
+  Mono m;
+
+  /* iteracyjnie, aby długość listy nie przekładała się na głębokość stosu */
+  for (; head; head = head->tail) {
+    m = MonoClone(&head->m);
+    tracer = MonoListAppend(tracer, &m);
+  }
 
-  return elem;
+  return cpy;
 }
 
 Mono* CloneMonoArray(size_t count, const Mono monos[])
@@ -322,6 +393,282 @@ static Mono* MonosArrayAppend(size_t* len, size_t* size, Mono* m, Mono* monos)
   return monos;
 }
 
+/**
+ * Wykładnik najmniejszego jednomianu niepustej listy, czyli jej ostatniego.
+ * @param[in] head : niepusta lista
+ * @return najmniejszy wykładnik w @p head
+ */
+static poly_exp_t MonoListMinExp(const MonoList* head)
+{
+  assert(head);
+
+  while (head->tail)
+    head = head->tail;
+
+  return head->m.exp;
+}
+
+bool MonoListIsFlat(const MonoList* head)
+{
+  for (; head; head = head->tail) {
+    if (!PolyIsCoeff(&head->m.p))
+      return false;
+  }
+
+  return true;
+}
+
+/**
+ * Liczba bitów wykładnika, czyli liczba obrotów pętli szybkiego potęgowania.
+ * @param[in] n : nieujemny wykładnik
+ * @return @f$\lfloor \log_2 n \rfloor + 1@f$, a dla zera zero
+ */
+static size_t BitLength(poly_exp_t n)
+{
+  size_t bits = 0;
+
+  for (; n > 0; n /= 2)
+    ++bits;
+
+  return bits;
+}
+
+/**
+ * Przejście @ref PolyShapeOf po poziomie @p level.
+ * @param[in] p : niebędący współczynnikiem wielomian zmiennej numer @p level
+ * @param[in] level : numer poziomu
+ * @param[in] levels : liczba przeglądanych poziomów
+ * @param[in,out] shape : uzupełniany kształt
+ */
+static void PolyShapeAt(const Poly* p, size_t level, size_t levels,
+                        PolyShape* shape)
+{
+  if (level + 1 > shape->vars)
+    shape->vars = level + 1;
+
+  if (level < POLY_SHAPE_LEVELS && MonoListDeg(p->list) > shape->deg[level])
+    shape->deg[level] = MonoListDeg(p->list);
+
+  for (const MonoList* ml = p->list; ml; ml = ml->tail) {
+    if (level < POLY_SHAPE_LEVELS)
+      ++shape->terms[level];
+
+    ++shape->size;
+
+    if (level == 0) {
+      shape->min = ml->m.exp;
+      shape->flat = shape->flat && PolyIsCoeff(&ml->m.p);
+
+      if (ml->m.exp > 1)
+        shape->squarings += BitLength(ml->m.exp) - 1;
+    }
+
+    if (level + 1 < levels && !PolyIsCoeff(&ml->m.p))
+      PolyShapeAt(&ml->m.p, level + 1, levels, shape);
+  }
+}
+
+void PolyShapeOf(const Poly* p, size_t levels, PolyShape* shape)
+{
+  assert(levels > 0);
+
+  shape->vars = 0;
+  shape->size = 0;
+  shape->min = 0;
+  shape->density = 0;
+  shape->flat = true;
+  shape->squarings = 0;
+
+  for (size_t i = 0; i < POLY_SHAPE_LEVELS; ++i) {
+    shape->deg[i] = PolyIsZero(p) ? -1 : 0;
+    shape->terms[i] = 0;
+  }
+
+  if (PolyIsCoeff(p))
+    return;
+
+  PolyShapeAt(p, 0, levels, shape);
+  shape->density =
+    (double)shape->terms[0] / ((double)shape->deg[0] - shape->min + 1);
+}
+
+bool PolyShapeFitsDense(const PolyShape* p, const PolyShape* q)
+{
+  long long span, prods;
+
+  if (p->vars == 0 || q->vars == 0)
+    return false;
+
+  span = (long long)p->deg[0] + q->deg[0] - p->min - q->min + 1;
+  prods = (long long)p->terms[0] * q->terms[0];
+
+  /* dzielenie zamiast mnożenia, by duży współczynnik się nie przepełnił */
+  return (span + prods - 1) / prods <= tuning.dense_ratio;
+}
+
+bool PolyMulFitsDense(const Poly* p, const Poly* q)
+{
+  PolyShape ps, qs;
+
+  if (PolyIsCoeff(p) || PolyIsCoeff(q))
+    return false;
+
+  PolyShapeOf(p, 1, &ps);
+  PolyShapeOf(q, 1, &qs);
+  return PolyShapeFitsDense(&ps, &qs);
+}
+
+/**
+ * Zamiana tablicy współczynników @p acc (indeksowanej wykładnikami
+ * przesuniętymi o @p min) w wielomian. Zera są pomijane.
+ * @param[in] acc : tablica współczynników
+ * @param[in] span : rozmiar tablicy
+ * @param[in] min : wykładnik odpowiadający zerowemu indeksowi
+ * @return wielomian o współczynnikach z @p acc
+ */
+static Poly PolyFromCoeffArray(const poly_coeff_t acc[], size_t span,
+                               poly_exp_t min)
+{
+  Poly p = PolyZero();
+  MonoList** tracer = &p.list;
+  Mono m;
+
+  /* od najwyższego wykładnika, bo tak posortowane są listy */
+  for (size_t i = span; i-- > 0;) {
+    if (acc[i] == 0)
+      continue;
+
+    m = (Mono) {
+      .p = PolyFromCoeff(acc[i]), .exp = min + (poly_exp_t)i
+    };
+    tracer = MonoListAppend(tracer, &m);
+  }
+
+  if (PolyIsPseudoCoeff(p.list))
+    Decoeffise(&p);
+
+  return p;
+}
+
+/**
+ * Zamiana tablicy wielomianów @p acc (indeksowanej wykładnikami przesuniętymi
+ * o @p min) w wielomian. Przejmuje wielomiany z @p acc na własność, a zerowe
+ * pomija.
+ * @param[in,out] acc : tablica współczynników-wielomianów
+ * @param[in] span : rozmiar tablicy
+ * @param[in] min : wykładnik odpowiadający zerowemu indeksowi
+ * @return wielomian o współczynnikach z @p acc
+ */
+static Poly PolyFromPolyArray(Poly acc[], size_t span, poly_exp_t min)
+{
+  Poly p = PolyZero();
+  MonoList** tracer = &p.list;
+  Mono m;
+
+  for (size_t i = span; i-- > 0;) {
+    if (PolyIsZero(acc + i))
+      continue;
+
+    m = MonoFromPoly(acc + i, min + (poly_exp_t)i);
+    tracer = MonoListAppend(tracer, &m);
+  }
+
+  if (PolyIsPseudoCoeff(p.list))
+    Decoeffise(&p);
+
+  return p;
+}
+
+/**
+ * Mnożenie na tablicy (patrz @ref PolyMulDense) z pominięciem jednomianów
+ * stopnia całkowitego większego niż @p maxdeg. Dla @p maxdeg równego
+ * `LLONG_MAX` iloczyn jest pełny. Wiersze, w których nawet najmniejszy
+ * wykładnik przekracza ograniczenie, są pomijane w całości.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[in] maxdeg : ograniczenie stopnia
+ * @return @f$p \cdot q@f$ obcięty do stopnia @p maxdeg
+ */
+static Poly PolyMulDenseUpTo(const Poly* p, const Poly* q, long long maxdeg)
+{
+  poly_exp_t qmin = MonoListMinExp(q->list);
+  poly_exp_t min = MonoListMinExp(p->list) + qmin;
+  long long max = (long long)MonoListDeg(p->list) + MonoListDeg(q->list);
+  bool trunc = maxdeg != LLONG_MAX;
+  poly_coeff_t* coeffs;
+  Poly* polys;
+  size_t span;
+  size_t i;
+  Poly pq;
+  Poly prod;
+
+  assert(PolyMulFitsDense(p, q));
+
+  if (max > maxdeg)
+    max = maxdeg;
+
+  if (max < min)
+    return PolyZero();
+
+  span = max - min + 1;
+
+  if (MonoListIsFlat(p->list) && MonoListIsFlat(q->list)) {
+    /* same stałe współczynniki -- sumujemy wprost liczby */
+    coeffs = calloc(span, sizeof(poly_coeff_t));
+    CHECK_PTR(coeffs);
+
+    for (MonoList* pl = p->list; pl; pl = pl->tail) {
+      if ((long long)pl->m.exp + qmin > max)
+        continue;
+
+      for (MonoList* ql = q->list; ql; ql = ql->tail) {
+        i = pl->m.exp + ql->m.exp - min;
+
+        if (i < span)
+          coeffs[i] += pl->m.p.coeff * ql->m.p.coeff;
+      }
+    }
+
+    pq = PolyFromCoeffArray(coeffs, span, min);
+    free(coeffs);
+    return pq;
+  }
+
+  polys = malloc(span * sizeof(Poly));
+  CHECK_PTR(polys);
+
+  for (i = 0; i < span; ++i)
+    polys[i] = PolyZero();
+
+  for (MonoList* pl = p->list; pl; pl = pl->tail) {
+    if ((long long)pl->m.exp + qmin > max)
+      continue;
+
+    for (MonoList* ql = q->list; ql; ql = ql->tail) {
+      i = pl->m.exp + ql->m.exp - min;
+
+      if (i >= span)
+        continue;
+
+      if (trunc)
+        prod = PolyMulTrunc(&pl->m.p, &ql->m.p, maxdeg - (i + min));
+      else
+        prod = PolyMul(&pl->m.p, &ql->m.p);
+
+      PolyIncorporate(polys + i, &prod);
+    }
+  }
+
+  pq = PolyFromPolyArray(polys, span, min);
+  free(polys);
+  return pq;
+}
+
+Poly PolyMulDense(const Poly* p, const Poly* q)
+{
+  return PolyMulDenseUpTo(p, q, LLONG_MAX);
+}
+
 /**
  * Alternatywne mnożenie __dużych__ wielomianów. Działa dokładnie tak samo jak
  * @ref PolyMul, ale stosuje inny mechanizm budowy wieomianu z jednomianów
@@ -341,7 +688,7 @@ static Poly PolyMulLong(const Poly* p, const Poly* q)
   Poly pq;
   /* jednomiany należące do wielomianów p, q i p * q */
   Mono pm, qm, pqm;
-  size_t size = BIG_MUL_ARRAY_INIT_SIZE;
+  size_t size = tuning.big_mul_init;
   size_t len = 0;
   Mono* monos;
 
@@ -351,6 +698,9 @@ static Poly PolyMulLong(const Poly* p, const Poly* q)
   if (PolyIsCoeff(q))
     return PolyMulCoeff(p, q->coeff);
 
+  if (PolyMulFitsDense(p, q))
+    return PolyMulDense(p, q);
+
   monos = MonosArray(size);
 
   for (MonoList* pl = p->list; pl; pl = pl->tail) {
@@ -378,20 +728,120 @@ Mono MonoMul(const Mono* m, const Mono* t)
   return mt;
 }
 
+Poly PolyMulMono(const Poly* p, const Mono* m)
+{
+  Poly pm = PolyZero();
+  /* tracer wskazuje na miejsce, gdzie podpięty zostanie kolejny jednomian */
+  MonoList** tracer = &pm.list;
+  Mono prod;
+
+  assert(!PolyIsCoeff(p));
+
+  /* mnożenie przez jednomian zachowuje porządek wykładników, zatem
+   * jednomiany iloczynu wystarczy dopinać na koniec listy */
+  for (MonoList* pl = p->list; pl; pl = pl->tail) {
+    prod = MonoMul(&pl->m, m);
+
+    if (PolyIsZero(&prod.p))
+      MonoDestroy(&prod);
+    else
+      tracer = MonoListAppend(tracer, &prod);
+  }
+
+  if (PolyIsPseudoCoeff(pm.list))
+    Decoeffise(&pm);
+
+  return pm;
+}
+
+Poly PolySquare(const Poly* p)
+{
+  Geobucket sq;
+  Poly row;
+  Mono diag;
+
+  if (PolyIsCoeff(p))
+    return PolyFromCoeff(p->coeff * p->coeff);
+
+  if (PolyMulFitsDense(p, p))
+    return PolyMulDense(p, p);
+
+  GeobucketInit(&sq);
+
+  /* wiersz jednomianu m to m^2 + 2 m (jednomiany za m) -- posortowany, bo
+   * jednomiany za m mają mniejsze wykładniki */
+  for (MonoList* pl = p->list; pl; pl = pl->tail) {
+    diag.p = PolySquare(&pl->m.p);
+    diag.exp = pl->m.exp + pl->m.exp;
+    row = PolyFromMonos(1, &diag);
+    GeobucketInsert(&sq, &row);
+
+    if (pl->tail) {
+      row = PolyMulMono(&(Poly) {.coeff = 0, .list = pl->tail}, &pl->m);
+      PolyMulCoeffComp(&row, 2);
+      GeobucketInsert(&sq, &row);
+    }
+  }
+
+  return GeobucketFinalise(&sq);
+}
+
 static MonoList* MonoListMulCoeff(MonoList* head, poly_coeff_t coeff);
 
+void PolyMulCoeffComp(Poly* p, poly_coeff_t coeff)
+{
+  if (PolyIsCoeff(p)) {
+    p->coeff *= coeff;
+    return;
+  }
+
+  p->list = MonoListMulCoeff(p->list, coeff);
+
+  if (PolyIsPseudoCoeff(p->list))
+    Decoeffise(p);
+}
+
 /**
- * Pomnożenie wielomianu @p p przez współczynnik @p coeff ''w miejscu''.
- * Odpowiednik operacji `p *= c`.
- * @param[in,out] p : wielomian @f$ p(x) @f$
- * @param[in] coeff : współczynnik @f$ c @f$
+ * Pomnożenie wielomianu @p p przez wielomian @p q ''w miejscu''. Odpowiednik
+ * operacji `p *= q`.
+ * @param[in,out] p : wielomian @f$ p @f$
+ * @param[in] q : wielomian @f$ q @f$
  */
-static void PolyMulCoeffComp(Poly* p, poly_coeff_t coeff)
+static void PolyMulComp(Poly* p, const Poly* q)
 {
-  if (PolyIsCoeff(p))
-    p->coeff *= coeff;
-  else
-    p->list = MonoListMulCoeff(p->list, coeff);
+  Poly pq;
+
+  if (PolyIsCoeff(q)) {
+    PolyMulCoeffComp(p, q->coeff);
+  } else {
+    pq = PolyMul(p, q);
+    PolyDestroy(p);
+    *p = pq;
+  }
+}
+
+void PolyMulMonoComp(Poly* p, const Mono* m)
+{
+  MonoList** tracer = &p->list;
+  MonoList* tmp;
+
+  assert(!PolyIsCoeff(p));
+
+  while (*tracer) {
+    (*tracer)->m.exp += m->exp;
+    PolyMulComp(&(*tracer)->m.p, &m->p);
+
+    if (PolyIsZero(&(*tracer)->m.p)) {
+      tmp = *tracer;
+      *tracer = tmp->tail;
+      free(tmp);
+    } else {
+      tracer = &(*tracer)->tail;
+    }
+  }
+
+  if (PolyIsPseudoCoeff(p->list))
+    Decoeffise(p);
 }
 
 /**
@@ -404,21 +854,22 @@ static void PolyMulCoeffComp(Poly* p, poly_coeff_t coeff)
  */
 static MonoList* MonoListMulCoeff(MonoList* head, poly_coeff_t coeff)
 {
-  MonoList* tail;
+  MonoList** tracer = &head;
+  MonoList* node;
 
-  if (!head)
-    return NULL;
-
-  PolyMulCoeffComp(&head->m.p, coeff);
+  /* iteracyjnie, aby długość listy nie przekładała się na głębokość stosu */
+  while ((node = *tracer)) {
+    PolyMulCoeffComp(&node->m.p, coeff);
 
-  if (PolyIsZero(&head->m.p)) {
-    MonoDestroy(&head->m);
-    tail = head->tail;
-    free(head);
-    return MonoListMulCoeff(tail, coeff);
+    if (PolyIsZero(&node->m.p)) {
+      MonoDestroy(&node->m);
+      *tracer = node->tail;
+      free(node);
+    } else {
+      tracer = &node->tail;
+    }
   }
 
-  head->tail = MonoListMulCoeff(head->tail, coeff);
   return head;
 }
 
@@ -426,10 +877,6 @@ Poly PolyMulCoeff(const Poly* p, poly_coeff_t coeff)
 {
   Poly pc = PolyClone(p);
   PolyMulCoeffComp(&pc, coeff);
-
-  if (PolyIsPseudoCoeff(pc.list))
-    Decoeffise(&pc);
-
   return pc;
 }
 
@@ -464,7 +911,20 @@ bool MonoIsEq(const Mono* m, const Mono* t)
  */
 static inline bool PolyBigPower(const Poly* p, poly_coeff_t n)
 {
-  return n > BIG_EXP && p->list && p->list->tail;
+  return n > tuning.big_exp && p->list && p->list->tail;
+}
+
+/**
+ * Potęga jednomianu: współczynnik potęgowany jest w głąb, a wykładnik mnożony.
+ * @param[in] m : jednomian @f$m@f$
+ * @param[in] n : dodatni wykładnik @f$n@f$
+ * @return @f$m^n@f$ jako wielomian
+ */
+static Poly MonoPow(const Mono* m, poly_coeff_t n)
+{
+  Mono pow = {.p = PolyPow(&m->p, n), .exp = m->exp * n};
+
+  return PolyFromMonos(1, &pow);
 }
 
 /* ten sam algorytm co w potęgowaniu liczb stosowanym w PolyAt w pliku poly.c */
@@ -472,6 +932,7 @@ Poly PolyPow(const Poly* p, poly_coeff_t n)
 {
   bool big = PolyBigPower(p, n);
   Poly pow = PolyFromCoeff(1);
+  PolyShape shape;
   Poly tmppow;
   /* jako, że a to na początku płytka kopia p, to muszę wiedzieć czy się
    * zmieniło zanim wywołam na nim destrukcję */
@@ -479,21 +940,26 @@ Poly PolyPow(const Poly* p, poly_coeff_t n)
   Poly a = *p;
   Poly tmpa;
 
-  assert(!PolyIsCoeff(p));
   assert(n >= 0);
 
   if (n == 0 || PolyIsEq(p, &pow))
     return pow;
 
+  PolyShapeOf(p, 1, &shape);
+
+  /* potęga jednomianu to jeden jednomian -- bez żadnego mnożenia list */
+  if (shape.terms[0] == 1)
+    return MonoPow(&p->list->m, n);
+
   while (n > 1) {
     if (n % 2 == 0) {
-      tmpa = big ? PolyMulLong(&a, &a) : PolyMul(&a, &a);
+      tmpa = big ? PolyMulLong(&a, &a) : PolySquare(&a);
       n /= 2;
     } else {
       tmppow = big ? PolyMulLong(&pow, &a) : PolyMul(&pow, &a);
       PolyDestroy(&pow);
       pow = tmppow;
-      tmpa = big ? PolyMulLong(&a, &a) : PolyMul(&a, &a);
+      tmpa = big ? PolyMulLong(&a, &a) : PolySquare(&a);
       n = (n - 1) / 2;
     }
 
@@ -561,6 +1027,143 @@ Poly PolyGetPow(const Poly powers[], size_t n)
   return res;
 }
 
+Poly PolyTrunc(const Poly* p, poly_exp_t deg)
+{
+  Poly t = PolyZero();
+  MonoList** tracer = &t.list;
+  Mono m;
+
+  if (deg < 0)
+    return PolyZero();
+
+  if (PolyIsCoeff(p))
+    return PolyClone(p);
+
+  for (MonoList* pl = p->list; pl; pl = pl->tail) {
+    if (pl->m.exp > deg)
+      continue;
+
+    m.exp = pl->m.exp;
+    m.p = PolyTrunc(&pl->m.p, deg - pl->m.exp);
+
+    if (!PolyIsZero(&m.p))
+      tracer = MonoListAppend(tracer, &m);
+  }
+
+  if (PolyIsPseudoCoeff(t.list))
+    Decoeffise(&t);
+
+  return t;
+}
+
+Poly PolyMulTrunc(const Poly* p, const Poly* q, poly_exp_t deg)
+{
+  Geobucket pq;
+  MonoList** tracer;
+  poly_exp_t qmin;
+  Poly row;
+  Mono prod;
+  long long e;
+
+  if (deg < 0)
+    return PolyZero();
+
+  if (PolyIsCoeff(p) && PolyIsCoeff(q))
+    return PolyFromCoeff(p->coeff * q->coeff);
+
+  if (PolyIsCoeff(p) || PolyIsCoeff(q)) {
+    row = PolyIsCoeff(p) ? PolyTrunc(q, deg) : PolyTrunc(p, deg);
+    PolyMulCoeffComp(&row, PolyIsCoeff(p) ? p->coeff : q->coeff);
+    return row;
+  }
+
+  if (PolyMulFitsDense(p, q))
+    return PolyMulDenseUpTo(p, q, deg);
+
+  qmin = MonoListMinExp(q->list);
+  GeobucketInit(&pq);
+
+  for (MonoList* pl = p->list; pl; pl = pl->tail) {
+    /* wiersz, w którym nawet najmniejszy iloczyn przekracza ograniczenie,
+     * pomijamy w całości */
+    if ((long long)pl->m.exp + qmin > deg)
+      continue;
+
+    row = PolyZero();
+    tracer = &row.list;
+
+    for (MonoList* ql = q->list; ql; ql = ql->tail) {
+      e = (long long)pl->m.exp + ql->m.exp;
+
+      if (e > deg)
+        continue;
+
+      prod.exp = e;
+      prod.p = PolyMulTrunc(&pl->m.p, &ql->m.p, deg - e);
+
+      if (!PolyIsZero(&prod.p))
+        tracer = MonoListAppend(tracer, &prod);
+    }
+
+    if (PolyIsPseudoCoeff(row.list))
+      Decoeffise(&row);
+
+    GeobucketInsert(&pq, &row);
+  }
+
+  return GeobucketFinalise(&pq);
+}
+
+bool PolyPowFits(const Poly* p, poly_coeff_t n)
+{
+  poly_exp_t deg = PolyDeg(p);
+
+  return deg <= 0 || n <= INT_MAX / deg;
+}
+
+Poly PolyPowTrunc(const Poly* p, poly_coeff_t n, poly_exp_t deg)
+{
+  Poly pow = PolyFromCoeff(1);
+  Poly a = PolyTrunc(p, deg);
+  Poly tmp;
+
+  assert(!PolyIsCoeff(p));
+  assert(n >= 0);
+
+  if (deg < 0) {
+    PolyDestroy(&a);
+    return PolyZero();
+  }
+
+  /* potęgowanie przez podnoszenie do kwadratu, z obcinaniem po każdym
+   * mnożeniu */
+  while (n > 0 && !PolyIsZero(&a)) {
+    if (n % 2 == 1) {
+      tmp = PolyMulTrunc(&pow, &a, deg);
+      PolyDestroy(&pow);
+      pow = tmp;
+    }
+
+    n /= 2;
+
+    if (n > 0) {
+      tmp = PolyMulTrunc(&a, &a, deg);
+      PolyDestroy(&a);
+      a = tmp;
+    }
+  }
+
+  /* jeśli podstawa wyzerowała się przed wyczerpaniem wykładnika, to taka też
+   * jest potęga */
+  if (n > 0) {
+    PolyDestroy(&pow);
+    pow = PolyZero();
+  }
+
+  PolyDestroy(&a);
+  return pow;
+}
+
 static void MonoIncorporate(Mono* m, Mono* t);
 
 /**
@@ -571,48 +1174,52 @@ static void MonoIncorporate(Mono* m, Mono* t);
  * na parę o równych wykładnikach włącza zawartość prawej głowy w lewą i zwalnia
  * odpowiednio pamięć. W przypadku gdy dokonanie @p lhead `+=+` @p rhead
  * doprowadzi do wyzerowania się @p lhead to zwalnia pamięć zarazem @p lhead jak
- * i @p rhead, po czym rekurencyjnie wywołuje się na ich ogonach.
+ * i @p rhead, po czym przechodzi do ich ogonów. Wynik doklejany jest przez
+ * wskaźnik na ostatni ogon, więc długość list nie przekłada się na głębokość
+ * stosu.
  * @param[in,out] lhead : głowa lewej listy
  * @param[in,out] rhead : głowa prawej listy
  * @return głowa listy @p lhead `+=+` @p rhead
  */
 static MonoList* MonoListsJoin(MonoList* lhead, MonoList* rhead)
 {
-  int cmp;
+  MonoList* head = NULL;
+  MonoList** tracer = &head;
   MonoList* tmp;
+  int cmp;
 
-  if (!lhead && !rhead)
-    return NULL;
-
-  cmp = MonoListsCmp(lhead, rhead);
-
-  if (cmp == 0) {
-    MonoIncorporate(&lhead->m, &rhead->m);
-
-    if (!PolyIsZero(&lhead->m.p)) {
-      tmp = rhead->tail;
-      free(rhead);
-      lhead->tail = MonoListsJoin(lhead->tail, tmp);
-      return lhead;
-    } else {
-      MonoDestroy(&lhead->m);
-      tmp = lhead->tail;
-      free(lhead);
-      lhead = tmp;
+  while (lhead || rhead) {
+    cmp = MonoListsCmp(lhead, rhead);
 
+    if (cmp == 0) {
+      MonoIncorporate(&lhead->m, &rhead->m);
       tmp = rhead->tail;
       free(rhead);
       rhead = tmp;
 
-      return MonoListsJoin(lhead, rhead);
+      if (PolyIsZero(&lhead->m.p)) {
+        MonoDestroy(&lhead->m);
+        tmp = lhead->tail;
+        free(lhead);
+        lhead = tmp;
+        continue;
+      }
+
+      *tracer = lhead;
+      lhead = lhead->tail;
+    } else if (cmp > 0) {
+      *tracer = lhead;
+      lhead = lhead->tail;
+    } else {
+      *tracer = rhead;
+      rhead = rhead->tail;
     }
-  } else if (cmp > 0) {
-    lhead->tail = MonoListsJoin(lhead->tail, rhead);
-    return lhead;
-  } else {
-    rhead->tail = MonoListsJoin(lhead, rhead->tail);
-    return rhead;
+
+    tracer = &(*tracer)->tail;
   }
+
+  *tracer = NULL;
+  return head;
 }
 
 Poly* PolyIncorporate(Poly* p, Poly* q)
@@ -642,3 +1249,350 @@ static void MonoIncorporate(Mono* m, Mono* t)
   assert(m->exp == t->exp);
   PolyIncorporate(&m->p, &t->p);
 }
+
+/**
+ * Funkcja porządkująca jednomiany dla qsorta.
+ * @param[in] m : jednomian jako `void*`
+ * @param[in] t : jednomian jako `void*`
+ * @return wynik z @ref MonoCmp
+ */
+static int MonoCmpQsort(const void* m, const void* t)
+{
+  return MonoCmp((Mono*)m, (Mono*)t);
+}
+
+Poly PolyFromMonos(size_t count, Mono monos[])
+{
+  Poly p = PolyZero();
+  MonoList** tracer = &p.list;
+  /* miejsce, w którym wisi ostatnio dopięty jednomian */
+  MonoList** last = NULL;
+  bool asc = true;
+  bool desc = true;
+  Mono tmp;
+
+  for (size_t i = 1; i < count; ++i) {
+    asc = asc && monos[i - 1].exp <= monos[i].exp;
+    desc = desc && monos[i - 1].exp > monos[i].exp;
+  }
+
+  /* uporządkowane wejście nie wymaga sortowania -- wystarczy je odwrócić */
+  if (desc) {
+    for (size_t i = 0; i < count / 2; ++i) {
+      tmp = monos[i];
+      monos[i] = monos[count - 1 - i];
+      monos[count - 1 - i] = tmp;
+    }
+  } else if (!asc) {
+    qsort(monos, count, sizeof(Mono), MonoCmpQsort);
+  }
+
+  /* listy trzymamy malejąco, zatem idziemy od końca tablicy, łącząc jednomiany
+   * o równych wykładnikach */
+  for (size_t i = count; i-- > 0;) {
+    if (PolyIsZero(&monos[i].p))
+      continue;
+
+    if (last && (*last)->m.exp == monos[i].exp) {
+      MonoIncorporate(&(*last)->m, monos + i);
+
+      if (PolyIsZero(&(*last)->m.p)) {
+        free(*last);
+        *last = NULL;
+        tracer = last;
+        last = NULL;
+      }
+    } else {
+      last = tracer;
+      tracer = MonoListAppend(tracer, monos + i);
+    }
+  }
+
+  if (PolyIsPseudoCoeff(p.list))
+    Decoeffise(&p);
+
+  return p;
+}
+
+void GeobucketInit(Geobucket* g)
+{
+  /* kubełki inicjalizowane są dopiero przy pierwszym użyciu, bo akumulator
+   * dla małych wielomianów zazwyczaj nie wychodzi poza kilka pierwszych */
+  g->used = 0;
+}
+
+/**
+ * Włączenie wielomianu @p p do @p i-tego kubełka akumulatora @p g wraz
+ * z uaktualnieniem jego rozmiaru. Wielomian @p p zostaje wyzerowany.
+ * @param[in,out] g : akumulator
+ * @param[in] i : indeks kubełka
+ * @param[in,out] p : wielomian do włączenia
+ */
+static void GeobucketMerge(Geobucket* g, size_t i, Poly* p)
+{
+  for (; g->used <= i; ++g->used) {
+    g->buckets[g->used] = PolyZero();
+    g->lens[g->used] = 0;
+  }
+
+  PolyIncorporate(g->buckets + i, p);
+  /* po złączeniu p i kubełek to te same struktury */
+  *p = PolyZero();
+  g->lens[i] = MonoListLength(g->buckets[i].list);
+}
+
+void GeobucketInsert(Geobucket* g, Poly* p)
+{
+  size_t len = MonoListLength(p->list);
+  size_t cap = GEOBUCKET_BASE;
+  size_t i = 0;
+
+  if (PolyIsZero(p))
+    return;
+
+  while (len > cap && i < GEOBUCKET_COUNT - 1) {
+    cap *= GEOBUCKET_BASE;
+    ++i;
+  }
+
+  GeobucketMerge(g, i, p);
+
+  /* przelewanie przepełnionych kubełków do coraz większych */
+  while (g->lens[i] > cap && i < GEOBUCKET_COUNT - 1) {
+    GeobucketMerge(g, i + 1, g->buckets + i);
+    g->lens[i] = 0;
+    cap *= GEOBUCKET_BASE;
+    ++i;
+  }
+}
+
+Poly GeobucketFinalise(Geobucket* g)
+{
+  Poly sum = PolyZero();
+
+  /* od najmniejszych kubełków, aby długa suma częściowa przechodziła przez
+   * jak najmniej złączeń */
+  for (size_t i = 0; i < g->used; ++i)
+    PolyIncorporate(&sum, g->buckets + i);
+
+  g->used = 0;
+  return sum;
+}
+
+/**
+ * Wymieszanie bitów liczby, tak by bliskie liczby dawały odległe skróty
+ * (końcówka generatora splitmix64).
+ * @param[in] h : liczba
+ * @return wymieszana liczba
+ */
+static inline uint64_t HashMix(uint64_t h)
+{
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebULL;
+  return h ^ (h >> 31);
+}
+
+uint64_t PolyHash(const Poly* p)
+{
+  /* lista dostaje inny początek niż współczynnik, by się z nim nie myliła */
+  uint64_t h = 0x9e3779b97f4a7c15ULL;
+
+  if (PolyIsCoeff(p))
+    return HashMix((uint64_t)p->coeff);
+
+  for (const MonoList* ml = p->list; ml; ml = ml->tail)
+    h = HashMix(h ^ (PolyHash(&ml->m.p) + (uint64_t)ml->m.exp));
+
+  return h;
+}
+
+size_t PolySize(const Poly* p)
+{
+  size_t size = 0;
+
+  if (PolyIsCoeff(p))
+    return 0;
+
+  for (const MonoList* ml = p->list; ml; ml = ml->tail)
+    size += 1 + PolySize(&ml->m.p);
+
+  return size;
+}
+
+PolyMeta PolyMetaOf(const Poly* p)
+{
+  PolyMeta meta = {PolyIsCoeff(p) ? PolyCoeffDeg(p) : -1, 0, 0};
+  PolyMeta sub;
+
+  if (PolyIsCoeff(p))
+    return meta;
+
+  for (const MonoList* ml = p->list; ml; ml = ml->tail) {
+    sub = PolyMetaOf(&ml->m.p);
+
+    if (ml->m.exp + sub.deg > meta.deg)
+      meta.deg = ml->m.exp + sub.deg;
+
+    if (sub.depth + 1 > meta.depth)
+      meta.depth = sub.depth + 1;
+
+    meta.size += 1 + sub.size;
+  }
+
+  return meta;
+}
+
+uint64_t FingerprintPow(uint64_t h, uint64_t n)
+{
+  uint64_t pow = 1;
+
+  for (; n > 0; n /= 2, h *= h) {
+    if (n % 2 == 1)
+      pow *= h;
+  }
+
+  return pow;
+}
+
+/**
+ * Odcisk wielomianu zmiennej @f$x_{depth}@f$. Zmienne dostają wartości
+ * nieparzyste, bo przy parzystych wysokie potęgi znikałyby modulo
+ * @f$2^{64}@f$.
+ * @param[in] p : wielomian
+ * @param[in] depth : numer zmiennej
+ * @return odcisk
+ */
+static uint64_t PolyFingerprintAt(const Poly* p, size_t depth)
+{
+  uint64_t x = HashMix(depth + 1) | 1;
+  uint64_t h = 0;
+
+  if (PolyIsCoeff(p))
+    return (uint64_t)p->coeff;
+
+  for (const MonoList* ml = p->list; ml; ml = ml->tail)
+    h += PolyFingerprintAt(&ml->m.p, depth + 1) * FingerprintPow(x, ml->m.exp);
+
+  return h;
+}
+
+uint64_t PolyFingerprint(const Poly* p)
+{
+  return PolyFingerprintAt(p, 0);
+}
+
+/** Liczby pierwsze rund @ref PolyIsEqProbable: największe mniejsze od
+ * @f$2^{61}@f$. */
+static const uint64_t probable_primes[POLY_PROBABLE_ROUNDS] = {
+  0x1fffffffffffffffULL, 0x1fffffffffffffe1ULL, 0x1fffffffffffffd3ULL,
+  0x1fffffffffffff1bULL
+};
+
+/** Licznik wywołań @ref PolyIsEqProbable, z którego losujemy punkty. */
+static uint64_t probable_calls;
+
+/**
+ * Mnożenie modulo liczba pierwsza rundy.
+ * @param[in] a : czynnik mniejszy od @p m
+ * @param[in] b : czynnik mniejszy od @p m
+ * @param[in] m : moduł
+ * @return @f$ab \bmod m@f$
+ */
+static inline uint64_t MulMod(uint64_t a, uint64_t b, uint64_t m)
+{
+  return (unsigned __int128)a * b % m;
+}
+
+/**
+ * Potęgowanie modulo liczba pierwsza rundy.
+ * @param[in] a : podstawa mniejsza od @p m
+ * @param[in] n : wykładnik
+ * @param[in] m : moduł
+ * @return @f$a^n \bmod m@f$
+ */
+static uint64_t PowMod(uint64_t a, uint64_t n, uint64_t m)
+{
+  uint64_t pow = 1;
+
+  for (; n > 0; n /= 2, a = MulMod(a, a, m)) {
+    if (n % 2 == 1)
+      pow = MulMod(pow, a, m);
+  }
+
+  return pow;
+}
+
+/**
+ * Wartości wielomianu zmiennej @f$x_{depth}@f$ we wszystkich rundach naraz.
+ * @param[in] p : wielomian
+ * @param[in] depth : numer zmiennej
+ * @param[in] seed : ziarno punktów
+ * @param[out] vals : wartości modulo liczby pierwsze kolejnych rund
+ * @return stopień wielomianu
+ */
+static poly_exp_t PolyEvalProbable(const Poly* p, size_t depth, uint64_t seed,
+                                   uint64_t vals[POLY_PROBABLE_ROUNDS])
+{
+  uint64_t sub[POLY_PROBABLE_ROUNDS];
+  poly_exp_t deg = -1;
+  poly_exp_t d;
+  uint64_t x;
+  uint64_t m;
+
+  if (PolyIsCoeff(p)) {
+    for (size_t r = 0; r < POLY_PROBABLE_ROUNDS; ++r) {
+      m = probable_primes[r];
+      vals[r] = (uint64_t)(((__int128)p->coeff % m + m) % m);
+    }
+
+    return PolyCoeffDeg(p);
+  }
+
+  for (size_t r = 0; r < POLY_PROBABLE_ROUNDS; ++r)
+    vals[r] = 0;
+
+  for (const MonoList* ml = p->list; ml; ml = ml->tail) {
+    d = PolyEvalProbable(&ml->m.p, depth + 1, seed, sub);
+
+    if (ml->m.exp + d > deg)
+      deg = ml->m.exp + d;
+
+    for (size_t r = 0; r < POLY_PROBABLE_ROUNDS; ++r) {
+      m = probable_primes[r];
+      x = HashMix(seed ^ HashMix(depth * POLY_PROBABLE_ROUNDS + r)) % m;
+      vals[r] = (vals[r] + MulMod(sub[r], PowMod(x, ml->m.exp, m), m)) % m;
+    }
+  }
+
+  return deg;
+}
+
+bool PolyIsEqProbable(const Poly* p, const Poly* q, double* error)
+{
+  uint64_t seed = HashMix(++probable_calls);
+  uint64_t pv[POLY_PROBABLE_ROUNDS];
+  uint64_t qv[POLY_PROBABLE_ROUNDS];
+  poly_exp_t pd = PolyEvalProbable(p, 0, seed, pv);
+  poly_exp_t qd = PolyEvalProbable(q, 0, seed, qv);
+  poly_exp_t deg = pd > qd ? pd : qd;
+  double bound = 1;
+
+  *error = 0;
+
+  for (size_t r = 0; r < POLY_PROBABLE_ROUNDS; ++r) {
+    if (pv[r] != qv[r])
+      return false;
+  }
+
+  /* równe stałe to równe współczynniki -- wtedy odpowiedź jest pewna */
+  if (deg <= 0)
+    return true;
+
+  for (size_t r = 1; r < POLY_PROBABLE_ROUNDS; ++r)
+    bound *= (double)deg / (double)(1ULL << 60);
+
+  *error = bound < 1 ? bound : 1;
+  return true;
+}
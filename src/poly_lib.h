@@ -11,8 +11,156 @@
 #ifndef __POLY_LIB_H__
 #define __POLY_LIB_H__
 
+#include <stdint.h>
+
 #include "poly.h"
 
+/** Liczba kubełków w akumulatorze @ref Geobucket. */
+#define GEOBUCKET_COUNT 32
+
+/** Liczba poziomów zagnieżdżenia opisywanych osobno w @ref PolyShape. */
+#define POLY_SHAPE_LEVELS 8
+
+/** Największy dopuszczalny @ref PolyTuning::dense_ratio. Większy pozwalałby
+ * mnożyć na tablicy czynniki o rozpiętości wykładników rzędu @f$2^{31}@f$. */
+#define POLY_TUNING_DENSE_MAX 1024
+
+/** Największy dopuszczalny @ref PolyTuning::big_mul_init. */
+#define POLY_TUNING_INIT_MAX (1 << 16)
+
+/** Liczba rund @ref PolyIsEqProbable, każda modulo innej 61-bitowej liczby
+ * pierwszej. */
+#define POLY_PROBABLE_ROUNDS 4
+
+/**
+ * Akumulator sum wielu wielomianów (tzw. _geobucket_). Kubełek o indeksie
+ * @f$i@f$ mieści wielomian o co najwyżej @f$4^{i+1}@f$ jednomianach. Składnik
+ * trafia do najmniejszego kubełka, w którym się zmieści, a przepełniony kubełek
+ * zostaje przelany do następnego. Dzięki temu sumowanie wielu składników
+ * o różnych rozmiarach nie przechodzi wciąż po jednej, coraz dłuższej liście.
+ */
+typedef struct Geobucket {
+  Poly buckets[GEOBUCKET_COUNT]; /**< kubełki z sumami częściowymi */
+  size_t lens[GEOBUCKET_COUNT];  /**< liczby jednomianów w kubełkach */
+  size_t used;                   /**< liczba zainicjalizowanych kubełków */
+} Geobucket;
+
+/**
+ * Metadane wielomianu zebrane jednym przejściem przez jego drzewo (patrz
+ * @ref PolyMetaOf).
+ */
+typedef struct PolyMeta {
+  poly_exp_t deg;               /**< stopień całkowity, jak @ref PolyDeg */
+  size_t size;                  /**< liczba jednomianów, jak @ref PolySize */
+  size_t depth;                 /**< głębokość zagnieżdżenia: liczba zmiennych,
+                                     od których wielomian może zależeć; dla
+                                     stałej zero */
+} PolyMeta;
+
+/**
+ * Kształt wielomianu zebrany jednym przejściem (patrz @ref PolyShapeOf), na
+ * podstawie którego mnożenie, potęgowanie i składanie wybierają algorytm.
+ * Pola poziomu zerowego opisują listę najbardziej zewnętrznej zmiennej.
+ */
+typedef struct PolyShape {
+  size_t vars;                  /**< liczba zmiennych (głębokość) w przejrzanej
+                                     części */
+  poly_exp_t deg[POLY_SHAPE_LEVELS]; /**< stopnie względem kolejnych zmiennych,
+                                          jak @ref PolyDegBy */
+  size_t terms[POLY_SHAPE_LEVELS]; /**< liczby jednomianów na kolejnych
+                                        poziomach */
+  size_t size;                  /**< liczba jednomianów w przejrzanej części */
+  poly_exp_t min;               /**< najmniejszy wykładnik poziomu zerowego */
+  double density;               /**< stosunek liczby jednomianów poziomu
+                                     zerowego do rozpiętości jego wykładników */
+  bool flat;                    /**< czy współczynniki poziomu zerowego są
+                                     stałymi */
+  size_t squarings;             /**< liczba podniesień do kwadratu, których
+                                     wymaga osobne potęgowanie do każdego
+                                     wykładnika poziomu zerowego */
+} PolyShape;
+
+/**
+ * Progi, na podstawie których biblioteka wybiera algorytmy mnożenia,
+ * potęgowania i składania. Domyślne (@ref PolyTuningDefault) wyznaczono na
+ * jednym komputerze; program `poly_tune` mierzy je na bieżącym i zapisuje
+ * profil, który wczytuje @ref PolyTuningLoad.
+ */
+typedef struct PolyTuning {
+  poly_coeff_t big_exp;         /**< wykładnik, powyżej którego potęgowanie
+                                     wielomianu o wielu jednomianach zbiera
+                                     iloczyny w tablicy */
+  size_t big_mul_init;          /**< początkowy rozmiar tej tablicy */
+  long long dense_ratio;        /**< największy stosunek rozpiętości
+                                     wykładników iloczynu do liczby iloczynów
+                                     jednomianów, przy którym mnożymy na
+                                     tablicy indeksowanej wykładnikami */
+  long long table_bias;         /**< o ile więcej podniesień do kwadratu musi
+                                     wymagać osobne potęgowanie niż tablica
+                                     potęg, by składanie jej użyło */
+} PolyTuning;
+
+/**
+ * Domyślne progi wyboru algorytmów.
+ * @return progi
+ */
+PolyTuning PolyTuningDefault(void);
+
+/**
+ * Bieżące progi wyboru algorytmów.
+ * @return progi
+ */
+const PolyTuning* PolyTuningGet(void);
+
+/**
+ * Ustawienie progów wyboru algorytmów. Nie zmienia wyników, a jedynie drogę
+ * do nich; należy je ustawiać przed rozpoczęciem obliczeń, bo nie są
+ * chronione przed współbieżnym dostępem.
+ * @param[in] t : progi; rozmiar tablicy dodatni, pozostałe nieujemne poza
+ *                @ref PolyTuning::table_bias. Stosunek rozpiętości i rozmiar
+ *                tablicy ponad @ref POLY_TUNING_DENSE_MAX i
+ *                @ref POLY_TUNING_INIT_MAX są do nich przycinane.
+ */
+void PolyTuningSet(const PolyTuning* t);
+
+/**
+ * Inicjalizacja pustego akumulatora (o sumie równej zeru).
+ * @param[out] g : akumulator
+ */
+void GeobucketInit(Geobucket* g);
+
+/**
+ * Dodanie wielomianu @p p do akumulatora @p g. Przejmuje @p p na własność,
+ * a w jego miejsce wstawia wielomian zerowy.
+ * @param[in,out] g : akumulator
+ * @param[in,out] p : składnik sumy
+ */
+void GeobucketInsert(Geobucket* g, Poly* p);
+
+/**
+ * Zsumowanie zawartości akumulatora @p g w jeden wielomian. Po wykonaniu
+ * akumulator jest pusty i może być ponownie użyty.
+ * @param[in,out] g : akumulator
+ * @return suma wszystkich wstawionych do @p g wielomianów
+ */
+Poly GeobucketFinalise(Geobucket* g);
+
+/**
+ * Długość listy jednomianów.
+ * @param[in] head : głowa listy
+ * @return liczba jednomianów w liście
+ */
+size_t MonoListLength(const MonoList* head);
+
+/**
+ * Dopięcie jednomianu @p m na koniec budowanej listy. Wywołujący dba o to, by
+ * jednomiany dopinane były w porządku malejących wykładników.
+ * @param[in,out] tracer : miejsce na nową komórkę (pusty ogon listy)
+ * @param[in] m : jednomian przejmowany na własność
+ * @return miejsce na kolejną komórkę
+ */
+MonoList** MonoListAppend(MonoList** tracer, const Mono* m);
+
 /**
  * Usunięcie z pamięci listy jednomianów.
  * @param[in] head : głowa listy do usunięcia.
@@ -102,6 +250,14 @@ void Decoeffise(Poly* p);
  */
 Poly PolyMulCoeff(const Poly* p, poly_coeff_t coeff);
 
+/**
+ * Pomnożenie wielomianu @p p przez współczynnik @p coeff ''w miejscu''.
+ * Odpowiednik operacji `p *= c`.
+ * @param[in,out] p : wielomian @f$ p(x) @f$
+ * @param[in] coeff : współczynnik @f$ c @f$
+ */
+void PolyMulCoeffComp(Poly* p, poly_coeff_t coeff);
+
 /**
  * Uprzeciwnienie wielomianu @p p.
  * @param[in,out] p : wielomian
@@ -117,12 +273,131 @@ void PolyNegComp(Poly* p);
 Mono MonoMul(const Mono* m, const Mono* t);
 
 /**
- * Podnoszenie wielomianu @p p do potęgi @p n.
+ * Iloczyn wielomianu niebędącego współczynnikiem i jednomianu. Lista wyniku
+ * budowana jest od razu w porządku, bez wstawiania.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] m : jednomian @f$m@f$
+ * @return @f$p \cdot m@f$
+ */
+Poly PolyMulMono(const Poly* p, const Mono* m);
+
+/**
+ * Kwadrat wielomianu. Iloczyny różnych jednomianów liczone są raz i
+ * podwajane, więc mnożeń jest mniej więcej o połowę mniej niż w
+ * @ref PolyMul.
+ * @param[in] p : wielomian @f$p@f$
+ * @return @f$p^2@f$
+ */
+Poly PolySquare(const Poly* p);
+
+/**
+ * Sprawdzian, czy wszystkie jednomiany listy mają stałe współczynniki.
+ * @param[in] head : lista jednomianów
+ * @return czy lista jest listą jednomianów o stałych współczynnikach
+ */
+bool MonoListIsFlat(const MonoList* head);
+
+/**
+ * Sprawdzian, czy iloczyn @p p i @p q opłaca się liczyć na tablicy
+ * indeksowanej wykładnikami (patrz @ref PolyMulDense) -- czy rozpiętość
+ * wykładników iloczynu jest niewielka względem liczby iloczynów jednomianów.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return czy mnożenie na tablicy jest opłacalne
+ */
+bool PolyMulFitsDense(const Poly* p, const Poly* q);
+
+/**
+ * Zebranie kształtu wielomianu jednym przejściem przez jego pierwsze
+ * @p levels poziomów. Przy @p levels równym 1 przejście ogranicza się do
+ * listy zewnętrznej zmiennej, tak jak rekurencyjne algorytmy same opisują
+ * kolejne poziomy, schodząc w głąb współczynników.
+ * @param[in] p : wielomian
+ * @param[in] levels : liczba przeglądanych poziomów, dodatnia
+ * @param[out] shape : kształt
+ */
+void PolyShapeOf(const Poly* p, size_t levels, PolyShape* shape);
+
+/**
+ * Sprawdzian jak @ref PolyMulFitsDense, na podstawie zebranych kształtów.
+ * @param[in] p : kształt @f$p@f$
+ * @param[in] q : kształt @f$q@f$
+ * @return czy mnożenie na tablicy jest opłacalne
+ */
+bool PolyShapeFitsDense(const PolyShape* p, const PolyShape* q);
+
+/**
+ * Mnożenie wielomianów o gęsto ułożonych wykładnikach. Iloczyny jednomianów
+ * sumowane są w tablicy indeksowanej wykładnikiem -- wprost w liczbach, gdy
+ * wszystkie współczynniki @p p i @p q są stałe, a w przeciwnym wypadku
+ * w wielomianach-współczynnikach. Na koniec tablica zamieniana jest w listę,
+ * bez żadnego wstawiania ani sortowania. Wymaga @ref PolyMulFitsDense.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @return @f$p \cdot q@f$
+ */
+Poly PolyMulDense(const Poly* p, const Poly* q);
+
+/**
+ * Pomnożenie wielomianu niebędącego współczynnikiem przez jednomian ''w
+ * miejscu'', na komórkach jego własnej listy. Odpowiednik operacji `p *= m`.
+ * @param[in,out] p : wielomian @f$p@f$
+ * @param[in] m : jednomian @f$m@f$
+ */
+void PolyMulMonoComp(Poly* p, const Mono* m);
+
+/**
+ * Podnoszenie wielomianu @p p do potęgi @p n. Współczynniki potęgowane są z
+ * przepełnieniem, tak jak przy kolejnych mnożeniach.
  * @param[in] p : wielomain @f$p@f$
  * @param[in] n : wykładnik @f$n@f$
  * @return spotęgowany wielomian @f$p^n@f$ */
 Poly PolyPow(const Poly* p, poly_coeff_t n);
 
+/**
+ * Sprawdza, czy wykładniki potęgi @f$p^n@f$ mieszczą się w typie
+ * @ref poly_exp_t. Dla stałych zawsze tak -- przepełniają się wtedy tylko
+ * współczynniki. Dla pozostałych wielomianów największy wykładnik potęgi
+ * wynosi co najwyżej @f$n \cdot \deg p@f$.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] n : nieujemny wykładnik @f$n@f$
+ * @return czy @ref PolyPow może policzyć @f$p^n@f$ bez przepełnienia
+ * wykładników
+ */
+bool PolyPowFits(const Poly* p, poly_coeff_t n);
+
+/**
+ * Obcięcie wielomianu do stopnia @p deg -- pominięcie wszystkich jednomianów
+ * stopnia (całkowitego) większego niż @p deg. Dla ujemnego @p deg wynikiem jest
+ * zero.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] deg : ograniczenie stopnia
+ * @return @f$p@f$ obcięty do stopnia @p deg
+ */
+Poly PolyTrunc(const Poly* p, poly_exp_t deg);
+
+/**
+ * Obcięty iloczyn dwu wielomianów (jak dla szeregów potęgowych). Jednomiany
+ * stopnia większego niż @p deg nie są w ogóle wyliczane: ograniczenie
+ * przenoszone jest w głąb współczynników, a wiersze iloczynu przekraczające
+ * je w całości są pomijane.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[in] deg : ograniczenie stopnia
+ * @return @f$p \cdot q@f$ obcięty do stopnia @p deg
+ */
+Poly PolyMulTrunc(const Poly* p, const Poly* q, poly_exp_t deg);
+
+/**
+ * Obcięta potęga wielomianu. Każde mnożenie pośrednie jest obcinane do stopnia
+ * @p deg (patrz @ref PolyMulTrunc).
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] n : wykładnik @f$n@f$
+ * @param[in] deg : ograniczenie stopnia
+ * @return @f$p^n@f$ obcięty do stopnia @p deg
+ */
+Poly PolyPowTrunc(const Poly* p, poly_coeff_t n, poly_exp_t deg);
+
 /**
  * Tworzenie tablicy potęg wielomianu @p q celem podstawienia go do @p p.
  * Rozmiar tablicy zapisany zostanie pod @p count. Tablica ma formę
@@ -170,6 +445,18 @@ poly_exp_t MonoListDeg(const MonoList* head);
  */
 bool MonoIsEq(const Mono* m, const Mono* t);
 
+/**
+ * Utworzenie wielomianu z tablicy jednomianów jednym przebiegiem. Przejmuje na
+ * własność zawartość tablicy @p monos (ale nie jej pamięć) i może dowolnie
+ * zmieniać jej kolejność. Tablica uporządkowana (rosnąco lub malejąco) zamieniana
+ * jest w listę liniowo, pozostałe są najpierw sortowane. Jednomiany o równych
+ * wykładnikach są sumowane.
+ * @param[in] count : liczba jednomianów
+ * @param[in,out] monos : tablica jednomianów
+ * @return wielomian będący sumą jednomianów
+ */
+Poly PolyFromMonos(size_t count, Mono monos[]);
+
 /**
  * Dokonanie głębokiej kopii tablicy @p monos.
  * @param[in] count : wielkość tablicy
@@ -178,4 +465,66 @@ bool MonoIsEq(const Mono* m, const Mono* t);
  */
 Mono* CloneMonoArray(size_t count, const Mono monos[]);
 
+/**
+ * Skrót struktury wielomianu. Równe wielomiany mają równe skróty, a różne --
+ * prawie zawsze różne.
+ * @param[in] p : wielomian
+ * @return 64-bitowy skrót
+ */
+uint64_t PolyHash(const Poly* p);
+
+/**
+ * Liczba jednomianów wielomianu na wszystkich poziomach, czyli liczba jego
+ * komórek list.
+ * @param[in] p : wielomian
+ * @return liczba jednomianów
+ */
+size_t PolySize(const Poly* p);
+
+/**
+ * Stopień, liczba jednomianów i głębokość zagnieżdżenia wielomianu, liczone
+ * jednym przejściem zamiast osobnych wywołań @ref PolyDeg i @ref PolySize.
+ * Względem zmiennych o indeksach niemniejszych od głębokości niezerowy
+ * wielomian ma stopień zero.
+ * @param[in] p : wielomian
+ * @return metadane wielomianu
+ */
+PolyMeta PolyMetaOf(const Poly* p);
+
+/**
+ * Odcisk wielomianu: jego wartość w ustalonym pseudolosowym punkcie, liczona
+ * modulo @f$2^{64}@f$ tak jak działania na współczynnikach. Odcisk sumy,
+ * różnicy, iloczynu, potęgi i przeciwnego wielomianu wynika więc wprost z
+ * odcisków argumentów. Równe wielomiany mają równe odciski; różne odciski
+ * rozstrzygają nierówność bez porównywania wielomianów.
+ * @param[in] p : wielomian
+ * @return odcisk
+ */
+uint64_t PolyFingerprint(const Poly* p);
+
+/**
+ * Potęgowanie odcisku, jak przy @ref PolyPow.
+ * @param[in] h : odcisk wielomianu
+ * @param[in] n : wykładnik, nieujemny
+ * @return odcisk @f$n@f$-tej potęgi
+ */
+uint64_t FingerprintPow(uint64_t h, uint64_t n);
+
+/**
+ * Probabilistyczne sprawdzenie równości wielomianów (lemat Schwartza-Zippela).
+ * Oba wielomiany obliczane są w losowym punkcie modulo każdej z
+ * @ref POLY_PROBABLE_ROUNDS 61-bitowych liczb pierwszych, jednym przejściem
+ * drzewa i bez alokacji. Odpowiedź `false` jest zawsze prawdziwa; odpowiedź
+ * `true` może być błędna z prawdopodobieństwem co najwyżej
+ * @f$(D/2^{60})^{r-1}@f$, gdzie @f$D@f$ to większy ze stopni, a @f$r@f$ --
+ * liczba rund. Jedna runda może nie zauważyć różnicy współczynników
+ * będącej wielokrotnością swojej liczby pierwszej, ale różnica mniejsza
+ * niż @f$2^{64}@f$ nie dzieli się przez dwie z nich.
+ * @param[in] p : wielomian @f$p@f$
+ * @param[in] q : wielomian @f$q@f$
+ * @param[out] error : ograniczenie prawdopodobieństwa błędu odpowiedzi
+ * @return czy @f$p = q@f$ z prawdopodobieństwem co najmniej `1 - *error`
+ */
+bool PolyIsEqProbable(const Poly* p, const Poly* q, double* error);
+
 #endif /* __POLY_LIB_H__ */
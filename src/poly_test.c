@@ -3,12 +3,17 @@
 #endif
 
 #include "poly.h"
+#include "poly_lib.h"
+#include "poly_io.h"
+#include "stack_op.h"
 #include <assert.h>
 #include <limits.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 /** DANE DO TESTÓW **/
 
@@ -4214,6 +4219,800 @@ static bool MemoryFreeTest(void)
   return res;
 }
 
+/**
+ * Sprawdza, czy operacje przejmujące argumenty na własność dają te same wyniki
+ * co ich odpowiedniki na stałych wielomianach i zostawiają po sobie zera.
+ */
+static bool OwnOpsTest(void)
+{
+  Poly p = P(P(C(1), 0, C(2), 3), 0, C(-1), 2, P(C(4), 1), 5);
+  Poly q = P(C(3), 0, P(C(-2), 1, C(1), 4), 2);
+  Poly r[2] = {P(C(1), 0, C(1), 1), C(-3)};
+  Poly exp, got, a, b;
+  bool res = true;
+
+  Poly (*binop[])(const Poly*, const Poly*) = {PolyAdd, PolySub, PolyMul};
+  Poly (*binown[])(Poly*, Poly*) = {PolyAddOwn, PolySubOwn, PolyMulOwn};
+
+  for (size_t i = 0; i < sizeof(binop) / sizeof(binop[0]); ++i) {
+    exp = binop[i](&p, &q);
+    a = PolyClone(&p);
+    b = PolyClone(&q);
+    got = binown[i](&a, &b);
+    res = res && PolyIsEq(&exp, &got) && PolyIsZero(&a) && PolyIsZero(&b);
+    PolyDestroy(&exp);
+    PolyDestroy(&got);
+  }
+
+  exp = PolyNeg(&p);
+  a = PolyClone(&p);
+  got = PolyNegOwn(&a);
+  res = res && PolyIsEq(&exp, &got) && PolyIsZero(&a);
+  PolyDestroy(&exp);
+  PolyDestroy(&got);
+
+  exp = PolyAt(&p, 2);
+  a = PolyClone(&p);
+  got = PolyAtOwn(&a, 2);
+  res = res && PolyIsEq(&exp, &got) && PolyIsZero(&a);
+  PolyDestroy(&exp);
+  PolyDestroy(&got);
+
+  exp = PolyCompose(&p, 2, r);
+  a = PolyClone(&p);
+  got = PolyComposeOwn(&a, 2, r);
+  res = res && PolyIsEq(&exp, &got) && PolyIsZero(&a) && PolyIsZero(r) &&
+        PolyIsZero(r + 1);
+  PolyDestroy(&exp);
+  PolyDestroy(&got);
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  return res;
+}
+
+/**
+ * Sprawdza, czy kwadrat jest równy iloczynowi wielomianu przez siebie.
+ */
+static bool SquareTest(void)
+{
+  /* rzadkie wykładniki omijają mnożenie na tablicy, a duże współczynniki
+   * sprawdzają zgodność przepełnień z PolyMul */
+  Poly polys[] = {
+    C(-7),
+    P(C(1), 0, C(1), 1),
+    P(P(C(1), 0, C(2), 3), 0, C(-1), 2, P(C(4), 1, C(1), 2), 1000000),
+    P(C(LONG_MAX), 1, C(LONG_MIN / 2), 70000, P(C(3), 5), 900000),
+    P(C(1L << 32), 0, C(1L << 31), 100000),
+  };
+  Poly sq, mul;
+  bool res = true;
+
+  for (size_t i = 0; i < sizeof(polys) / sizeof(polys[0]); ++i) {
+    sq = PolySquare(polys + i);
+    mul = PolyMul(polys + i, polys + i);
+    res = res && PolyIsEq(&sq, &mul);
+    PolyDestroy(&sq);
+    PolyDestroy(&mul);
+    PolyDestroy(polys + i);
+  }
+
+  return res;
+}
+
+/**
+ * Sprawdza, czy potęga jest równa kolejnym iloczynom, także dla
+ * współczynników, które przy tym się przepełniają.
+ */
+static bool PowTest(void)
+{
+  Poly polys[] = {C(0), C(-3), C(1LL << 40), P(C(2), 0, C(-1), 3),
+                  P(P(C(1), 1), 0, C(5), 2)};
+  bool res = true;
+  Poly pow, mul, tmp;
+
+  for (size_t i = 0; i < sizeof(polys) / sizeof(polys[0]); ++i) {
+    mul = C(1);
+
+    for (poly_coeff_t n = 0; n <= 6; ++n) {
+      pow = PolyPow(polys + i, n);
+      res = res && PolyIsEq(&pow, &mul);
+      PolyDestroy(&pow);
+      tmp = PolyMul(&mul, polys + i);
+      PolyDestroy(&mul);
+      mul = tmp;
+    }
+
+    PolyDestroy(&mul);
+    PolyDestroy(polys + i);
+  }
+
+  return res;
+}
+
+/**
+ * Sprawdza granicę wykładników potęgi, dla których wynik mieści się w
+ * @ref poly_exp_t, oraz to, że stałe można potęgować dowolnie.
+ */
+static bool PowFitsTest(void)
+{
+  Poly x = P(C(1), 1);
+  Poly xy = P(P(C(1), 1), 1);
+  Poly c = C(3);
+  Poly z = C(0);
+  Poly got, exp;
+  bool res;
+
+  res = PolyPowFits(&x, INT_MAX) &&
+        !PolyPowFits(&x, (poly_coeff_t)INT_MAX + 1) &&
+        !PolyPowFits(&x, 3000000000) && PolyPowFits(&xy, INT_MAX / 2) &&
+        !PolyPowFits(&xy, INT_MAX / 2 + 1) && !PolyPowFits(&xy, 1073741824) &&
+        PolyPowFits(&c, LONG_MAX) && PolyPowFits(&z, LONG_MAX);
+
+  got = PolyPow(&x, INT_MAX);
+  exp = P(C(1), INT_MAX);
+  res = res && PolyIsEq(&got, &exp) && PolyDeg(&got) == INT_MAX;
+  PolyDestroy(&got);
+  PolyDestroy(&exp);
+
+  got = PolyPow(&xy, INT_MAX / 2);
+  exp = P(P(C(1), INT_MAX / 2), INT_MAX / 2);
+  res = res && PolyIsEq(&got, &exp);
+  PolyDestroy(&got);
+  PolyDestroy(&exp);
+
+  PolyDestroy(&x);
+  PolyDestroy(&xy);
+  PolyDestroy(&c);
+  PolyDestroy(&z);
+  return res;
+}
+
+/**
+ * Sprawdza, czy równe wielomiany mają równe skróty, a te z testu -- różne,
+ * oraz liczenie jednomianów.
+ */
+static bool HashTest(void)
+{
+  Poly polys[] = {C(0), C(1), C(-1), P(C(1), 1), P(C(1), 2),
+                  P(C(2), 1), P(P(C(1), 1), 1), P(C(1), 0, C(1), 1),
+                  P(P(C(1), 0, C(1), 1), 3, C(5), 4)};
+  size_t sizes[] = {0, 0, 0, 1, 1, 1, 2, 2, 4};
+  bool res = true;
+  Poly cpy;
+
+  for (size_t i = 0; i < sizeof(polys) / sizeof(polys[0]); ++i) {
+    cpy = PolyClone(polys + i);
+    res = res && PolyHash(&cpy) == PolyHash(polys + i) &&
+          PolySize(polys + i) == sizes[i];
+    PolyDestroy(&cpy);
+
+    for (size_t j = 0; j < i; ++j)
+      res = res && PolyHash(polys + i) != PolyHash(polys + j);
+  }
+
+  for (size_t i = 0; i < sizeof(polys) / sizeof(polys[0]); ++i)
+    PolyDestroy(polys + i);
+
+  return res;
+}
+
+/**
+ * Sprawdza, czy metadane zbierane jednym przejściem zgadzają się z osobno
+ * liczonymi stopniem i rozmiarem.
+ */
+static bool MetaTest(void)
+{
+  Poly polys[] = {
+    C(0), C(-3), P(C(1), 4),
+    P(P(C(1), 2, P(C(5), 1), 3), 0, C(2), 7),
+    P(P(P(C(1), 1), 0), 5)
+  };
+  size_t depths[] = {0, 0, 1, 3, 3};
+  PolyMeta meta;
+  bool res = true;
+
+  for (size_t i = 0; i < sizeof(polys) / sizeof(Poly); ++i) {
+    meta = PolyMetaOf(polys + i);
+    res = res && meta.deg == PolyDeg(polys + i) &&
+          meta.size == PolySize(polys + i) && meta.depth == depths[i];
+
+    for (size_t idx = meta.depth; idx < meta.depth + 2; ++idx) {
+      res = res &&
+            PolyDegBy(polys + i, idx) == (PolyIsZero(polys + i) ? -1 : 0);
+    }
+
+    PolyDestroy(polys + i);
+  }
+
+  return res;
+}
+
+/**
+ * Sprawdza kształt wielomianu, a także czy mnożenie i potęgowanie
+ * jednomianów i czynników różnej długości zgadza się z mnożeniem na liście.
+ */
+static bool ShapeTest(void)
+{
+  Poly p = P(P(C(1), 2, P(C(5), 1), 3), 0, C(2), 7, C(-1), 9);
+  Poly m = P(P(C(3), 4), 5);
+  Poly q = P(C(1), 0, C(1), 1, C(1), 100);
+  PolyShape shape;
+  Poly got, exp;
+  bool res;
+
+  PolyShapeOf(&p, POLY_SHAPE_LEVELS, &shape);
+  res = shape.vars == 3 && shape.deg[0] == 9 && shape.deg[1] == 3 &&
+        shape.deg[2] == 1 && shape.deg[3] == 0 && shape.terms[0] == 3 &&
+        shape.terms[1] == 2 && shape.terms[2] == 1 && shape.size == 6 &&
+        shape.min == 0 && !shape.flat && shape.squarings == 2 + 3 &&
+        shape.density == 0.3;
+
+  PolyShapeOf(&p, 1, &shape);
+  res = res && shape.vars == 1 && shape.size == 3 && shape.terms[1] == 0;
+
+  got = PolyPow(&m, 3);
+  exp = P(P(C(27), 12), 15);
+  res = res && PolyIsEq(&got, &exp);
+  PolyDestroy(&got);
+  PolyDestroy(&exp);
+
+  got = PolyMul(&p, &q);
+  exp = PolyMul(&q, &p);
+  res = res && PolyIsEq(&got, &exp) && PolyDeg(&got) == 109;
+  PolyDestroy(&got);
+  PolyDestroy(&exp);
+
+  PolyDestroy(&p);
+  PolyDestroy(&m);
+  PolyDestroy(&q);
+  return res;
+}
+
+/**
+ * Sprawdza, czy skrajne progi wyboru algorytmów zmieniają jedynie drogę do
+ * wyniku mnożenia, potęgowania i składania, a nie sam wynik.
+ */
+static bool TuningTest(void)
+{
+  PolyTuning def = PolyTuningDefault();
+  PolyTuning extremes[] = {def, def, def};
+  Poly p = P(C(2), 0, P(C(1), 1, C(-3), 4), 3, C(1), 40);
+  Poly q[] = {P(C(1), 0, P(C(1), 2), 1)};
+  /* rozpiętość kwadratu rzędu 2^31 przy czterech iloczynach jednomianów */
+  Poly wide = P(C(1), 0, C(1), 1000000000);
+  Poly mul, pow, comp, sq;
+  Poly got;
+  bool res = true;
+
+  extremes[0].dense_ratio = 0;
+  extremes[0].big_exp = 0;
+  extremes[0].big_mul_init = 1;
+  extremes[0].table_bias = LLONG_MIN / 2;
+  extremes[1].dense_ratio = LLONG_MAX;
+  extremes[1].big_exp = LONG_MAX;
+  extremes[1].big_mul_init = SIZE_MAX;
+  extremes[1].table_bias = LLONG_MAX / 2;
+
+  mul = PolyMul(&p, q);
+  pow = PolyPow(&p, 5);
+  comp = PolyCompose(&p, 1, q);
+  sq = PolyMul(&wide, &wide);
+
+  for (size_t i = 0; i < sizeof(extremes) / sizeof(PolyTuning); ++i) {
+    PolyTuningSet(extremes + i);
+    res = res && PolyTuningGet()->big_exp == extremes[i].big_exp &&
+          PolyTuningGet()->dense_ratio <= POLY_TUNING_DENSE_MAX;
+
+    got = PolyMul(&wide, &wide);
+    res = res && PolyIsEq(&got, &sq);
+    PolyDestroy(&got);
+
+    got = PolyMul(&p, q);
+    res = res && PolyIsEq(&got, &mul);
+    PolyDestroy(&got);
+
+    got = PolyPow(&p, 5);
+    res = res && PolyIsEq(&got, &pow);
+    PolyDestroy(&got);
+
+    got = PolyCompose(&p, 1, q);
+    res = res && PolyIsEq(&got, &comp);
+    PolyDestroy(&got);
+  }
+
+  PolyTuningSet(&def);
+  PolyDestroy(&p);
+  PolyDestroy(q);
+  PolyDestroy(&wide);
+  PolyDestroy(&sq);
+  PolyDestroy(&mul);
+  PolyDestroy(&pow);
+  PolyDestroy(&comp);
+  return res;
+}
+
+/**
+ * Sprawdza, czy odcisk sumy, różnicy, iloczynu, potęgi i przeciwnego
+ * wielomianu wynika z odcisków argumentów.
+ */
+static bool FingerprintTest(void)
+{
+  Poly polys[] = {C(0), C(-5), C(LONG_MAX), P(C(1), 1), P(C(3), 0, C(-2), 7),
+                  P(P(C(1), 0, C(2), 3), 0, C(-1), 2, P(C(4), 1), 5)};
+  size_t n = sizeof(polys) / sizeof(polys[0]);
+  uint64_t hp, hq;
+  bool res = true;
+  Poly r;
+
+  for (size_t i = 0; i < n; ++i) {
+    hp = PolyFingerprint(polys + i);
+
+    for (size_t j = 0; j < n; ++j) {
+      hq = PolyFingerprint(polys + j);
+      r = PolyAdd(polys + i, polys + j);
+      res = res && PolyFingerprint(&r) == hp + hq;
+      PolyDestroy(&r);
+      r = PolySub(polys + i, polys + j);
+      res = res && PolyFingerprint(&r) == hp - hq;
+      PolyDestroy(&r);
+      r = PolyMul(polys + i, polys + j);
+      res = res && PolyFingerprint(&r) == hp * hq;
+      PolyDestroy(&r);
+      res = res && (i == j || hp != hq);
+    }
+
+    r = PolyNeg(polys + i);
+    res = res && PolyFingerprint(&r) == -hp;
+    PolyDestroy(&r);
+    r = PolyPow(polys + i, 5);
+    res = res && PolyFingerprint(&r) == FingerprintPow(hp, 5);
+    PolyDestroy(&r);
+  }
+
+  for (size_t i = 0; i < n; ++i)
+    PolyDestroy(polys + i);
+
+  return res;
+}
+
+/**
+ * Sprawdza probabilistyczną równość: złożenie i jego rozwinięcie są równe,
+ * a różnice -- także o wielokrotność liczby pierwszej rundy -- wykrywane.
+ */
+static bool ProbableTest(void)
+{
+  Poly p = P(C(1), 0, C(-2), 1, C(1), 3);
+  Poly q[] = {P(C(1), 0, C(1), 1)};
+  Poly composed = PolyCompose(&p, 1, q);
+  Poly expanded = P(C(1), 1, C(3), 2, C(1), 3);
+  Poly prime = C(0x1fffffffffffffffLL);
+  Poly zero = C(0);
+  Poly far = P(C(0x1fffffffffffffffLL), 2);
+  Poly near = P(C(-0x1fffffffffffffffLL), 2);
+  double error;
+  bool res = true;
+
+  res = res && PolyIsEqProbable(&composed, &expanded, &error) &&
+        error > 0 && error < 1e-40;
+  res = res && !PolyIsEqProbable(&composed, &p, &error) && error == 0;
+  res = res && !PolyIsEqProbable(&prime, &zero, &error);
+  res = res && !PolyIsEqProbable(&far, &near, &error);
+  res = res && PolyIsEqProbable(&prime, &prime, &error) && error == 0;
+
+  PolyDestroy(&p);
+  PolyDestroy(q);
+  PolyDestroy(&composed);
+  PolyDestroy(&expanded);
+  PolyDestroy(&far);
+  PolyDestroy(&near);
+  return res;
+}
+
+/**
+ * Sprawdza mnożenie na tablicy indeksowanej wykładnikami: dla płaskich
+ * i zagnieżdżonych czynników, także gdy współczynniki się znoszą, wynik
+ * zgadza się z mnożeniem list, a rzadkie czynniki nie trafiają na tablicę.
+ */
+static bool DenseMulTest(void)
+{
+  PolyTuning def = PolyTuningDefault();
+  PolyTuning lists = def;
+  /* (1 - x)(1 + x + x^2 + x^3) = 1 - x^4 */
+  Poly flat[] = {P(C(1), 0, C(-1), 1), P(C(1), 0, C(1), 1, C(1), 2, C(1), 3)};
+  /* (y + x)(y - x) = y^2 - x^2 */
+  Poly nested[] = {P(P(C(1), 1), 0, C(1), 1), P(P(C(1), 1), 0, C(-1), 1)};
+  Poly mixed[] = {P(C(2), 0, C(-5), 1, C(3), 3),
+                  P(C(1), 0, C(7), 1, C(-1), 2)};
+  Poly sparse = P(C(1), 0, C(1), 1000);
+  Poly* pairs[] = {flat, nested, mixed};
+  Poly expected[] = {P(C(1), 0, C(-1), 4), P(P(C(1), 2), 0, C(-1), 2),
+                     P(C(2), 0, C(9), 1, C(-37), 2, C(8), 3, C(21), 4,
+                       C(-3), 5)};
+  Poly dense, list, disp;
+  PolyShape ps;
+  bool res = !PolyMulFitsDense(&sparse, &sparse);
+
+  PolyShapeOf(&sparse, 1, &ps);
+  res = res && !PolyShapeFitsDense(&ps, &ps);
+  lists.dense_ratio = 0;
+
+  for (size_t i = 0; i < sizeof(pairs) / sizeof(pairs[0]); ++i) {
+    res = res && PolyMulFitsDense(pairs[i], pairs[i] + 1);
+
+    if (res) {
+      dense = PolyMulDense(pairs[i], pairs[i] + 1);
+      disp = PolyMul(pairs[i], pairs[i] + 1);
+      PolyTuningSet(&lists);
+      list = PolyMul(pairs[i], pairs[i] + 1);
+      PolyTuningSet(&def);
+      res = PolyIsEq(&dense, &list) && PolyIsEq(&disp, &list) &&
+            PolyIsEq(&list, expected + i);
+      PolyDestroy(&dense);
+      PolyDestroy(&disp);
+      PolyDestroy(&list);
+    }
+
+    PolyDestroy(pairs[i]);
+    PolyDestroy(pairs[i] + 1);
+    PolyDestroy(expected + i);
+  }
+
+  PolyDestroy(&sparse);
+  return res;
+}
+
+/**
+ * Sprawdza, czy obcięte mnożenie, potęgowanie i składanie dają to samo, co
+ * obcięcie pełnego wyniku.
+ */
+static bool TruncTest(void)
+{
+  Poly p = P(P(C(1), 0, C(2), 3), 0, C(-1), 2, P(C(4), 1, C(1), 2), 5);
+  Poly q = P(C(3), 0, P(C(-2), 1, C(1), 4), 2, C(7), 3);
+  Poly r[2] = {P(C(1), 0, C(1), 1), P(P(C(2), 1), 0, C(-1), 2)};
+  Poly full, exp, got;
+  bool res = true;
+
+  for (poly_exp_t deg = -1; deg <= 12; ++deg) {
+    full = PolyMul(&p, &q);
+    exp = PolyTrunc(&full, deg);
+    got = PolyMulTrunc(&p, &q, deg);
+    res = res && PolyIsEq(&exp, &got) && PolyDeg(&got) <= deg;
+    PolyDestroy(&full);
+    PolyDestroy(&exp);
+    PolyDestroy(&got);
+
+    full = PolyPow(&q, 3);
+    exp = PolyTrunc(&full, deg);
+    got = PolyPowTrunc(&q, 3, deg);
+    res = res && PolyIsEq(&exp, &got);
+    PolyDestroy(&full);
+    PolyDestroy(&exp);
+    PolyDestroy(&got);
+
+    full = PolyCompose(&p, 2, r);
+    exp = PolyTrunc(&full, deg);
+    got = PolyComposeTrunc(&p, 2, r, deg);
+    res = res && PolyIsEq(&exp, &got);
+    PolyDestroy(&full);
+    PolyDestroy(&exp);
+    PolyDestroy(&got);
+  }
+
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(r);
+  PolyDestroy(r + 1);
+  return res;
+}
+
+static bool AtVarTest(void)
+{
+  /* p = 5 + x_0^3 x_1 (1 + 2 x_2^2) */
+  Poly p = P(C(5), 0, P(P(C(1), 0, C(2), 2), 1), 3);
+  Poly got, exp;
+  bool res;
+
+  got = PolyAtVar(&p, 0, 2);
+  exp = PolyAt(&p, 2);
+  res = PolyIsEq(&got, &exp);
+  PolyDestroy(&got);
+  PolyDestroy(&exp);
+
+  got = PolyAtVar(&p, 1, 2);
+  exp = P(C(5), 0, P(C(2), 0, C(4), 2), 3);
+  res = res && PolyIsEq(&got, &exp);
+  PolyDestroy(&got);
+  PolyDestroy(&exp);
+
+  got = PolyAtVar(&p, 2, 3);
+  exp = P(C(5), 0, P(C(19), 1), 3);
+  res = res && PolyIsEq(&got, &exp);
+  PolyDestroy(&got);
+  PolyDestroy(&exp);
+
+  /* wyzerowanie wewnętrznego współczynnika usuwa jednomian */
+  got = PolyAtVar(&p, 1, 0);
+  res = res && PolyIsEq(&got, &(Poly) {.coeff = 5, .list = NULL});
+  PolyDestroy(&got);
+
+  got = PolyAtVar(&p, 7, 3);
+  res = res && PolyIsEq(&got, &p);
+  PolyDestroy(&got);
+
+  PolyDestroy(&p);
+  return res;
+}
+
+static bool GeobucketTest(void)
+{
+  const size_t count = 1000;
+  Geobucket g;
+  Poly sum, expected, p;
+  Mono* monos = calloc(count + 49, sizeof(Mono));
+  bool res;
+
+  assert(monos);
+  GeobucketInit(&g);
+
+  /* składniki różnych rozmiarów: x^i * (1 + x + ... + x^(i % 50)) */
+  for (size_t i = 0; i < count; ++i) {
+    Mono* row = calloc(i % 50 + 1, sizeof(Mono));
+    assert(row);
+
+    for (size_t j = 0; j <= i % 50; ++j)
+      row[j] = M(C(1), i + j);
+
+    p = PolyOwnMonos(i % 50 + 1, row);
+    GeobucketInsert(&g, &p);
+    assert(PolyIsZero(&p));
+  }
+
+  sum = GeobucketFinalise(&g);
+
+  /* współczynnik przy x^e to liczba takich i, że x^e występuje w i-tym
+   * składniku */
+  for (size_t e = 0; e < count + 49; ++e) {
+    poly_coeff_t c = 0;
+
+    for (size_t i = 0; i <= e && i < count; ++i)
+      c += e - i <= i % 50;
+
+    monos[e] = M(C(c), e);
+  }
+
+  expected = PolyOwnMonos(count + 49, monos);
+  res = PolyIsEq(&sum, &expected) && PolyDegBy(&sum, 0) == 1048;
+  PolyDestroy(&sum);
+  PolyDestroy(&expected);
+
+  /* pusty akumulator daje zero */
+  sum = GeobucketFinalise(&g);
+  res = res && PolyIsZero(&sum);
+
+  return res;
+}
+
+static bool SerializeRoundTrip(const Poly* p)
+{
+  size_t len;
+  unsigned char* buf = PolySerialize(p, &len);
+  Poly q;
+  bool res = PolyDeserialize(buf, len, &q);
+
+  res = res && PolyIsEq(p, &q);
+
+  if (res)
+    PolyDestroy(&q);
+
+  /* każdy ucięty zapis i zapis z nadmiarowym bajtem jest odrzucany */
+  for (size_t i = 0; res && i < len; ++i)
+    res = !PolyDeserialize(buf, i, &q);
+
+  buf = realloc(buf, len + 1);
+  assert(buf);
+  buf[len] = 0;
+  res = res && !PolyDeserialize(buf, len + 1, &q);
+
+  free(buf);
+  return res;
+}
+
+static bool SerializeTest(void)
+{
+  /* p = 5 + x_0^3 x_1 (1 + 2 x_2^2) + LONG_MIN x_0^INT_MAX */
+  Poly p = P(C(5), 0, P(P(C(1), 0, C(2), 2), 1), 3, C(LONG_MIN), INT_MAX);
+  Poly deep = C(-1);
+  Poly q;
+  bool res;
+  /* kolejno: zerowy współczynnik jednomianu, lista z samym (1,0), rosnące
+   * wykładniki i zła wersja */
+  const unsigned char bad[][9] = {
+    {'P', 'L', 'Y', POLY_IO_VERSION, 1, 3, 0, 0},
+    {'P', 'L', 'Y', POLY_IO_VERSION, 1, 0, 0, 2},
+    {'P', 'L', 'Y', POLY_IO_VERSION, 2, 5, 0, 2, 6},
+    {'P', 'L', 'Y', POLY_IO_VERSION + 1, 0, 2},
+  };
+  const size_t bad_len[] = {8, 8, 9, 6};
+
+  for (int i = 0; i < 5000; ++i)
+    deep = P(deep, i % 3 + 1);
+
+  res = SerializeRoundTrip(&p) && SerializeRoundTrip(&deep) &&
+        SerializeRoundTrip(&(Poly) {.coeff = 0, .list = NULL}) &&
+        SerializeRoundTrip(&(Poly) {.coeff = LONG_MAX, .list = NULL});
+
+  for (size_t i = 0; i < sizeof(bad_len) / sizeof(bad_len[0]); ++i)
+    res = res && !PolyDeserialize(bad[i], bad_len[i], &q);
+
+  PolyDestroy(&p);
+  PolyDestroy(&deep);
+  return res;
+}
+
+static bool ArraySerializeTest(void)
+{
+  Poly polys[] = {
+    P(C(5), 0, P(P(C(1), 0, C(2), 2), 1), 3, C(LONG_MIN), INT_MAX),
+    C(0),
+    P(C(-1), 4),
+  };
+  const size_t n = sizeof(polys) / sizeof(polys[0]);
+  size_t len;
+  unsigned char* buf = PolyArraySerialize(n, polys, &len);
+  Poly* read = NULL;
+  size_t count = 0;
+  bool res = PolyArrayDeserialize(buf, len, &count, &read) && count == n;
+
+  for (size_t i = 0; i < count; ++i) {
+    res = res && PolyIsEq(polys + i, read + i);
+    PolyDestroy(read + i);
+  }
+
+  free(read);
+
+  /* każdy ucięty zapis jest odrzucany */
+  for (size_t i = 0; res && i < len; ++i)
+    res = !PolyArrayDeserialize(buf, i, &count, &read);
+
+  free(buf);
+
+  /* pusty stos też da się zapisać */
+  buf = PolyArraySerialize(0, polys, &len);
+
+  if (res && PolyArrayDeserialize(buf, len, &count, &read)) {
+    res = count == 0;
+    free(read);
+  } else {
+    res = false;
+  }
+
+  free(buf);
+
+  for (size_t i = 0; i < n; ++i)
+    PolyDestroy(polys + i);
+
+  return res;
+}
+
+static bool FrozenMatches(const Poly* p)
+{
+  size_t len;
+  unsigned char* buf = PolyFreeze(p, &len);
+  FrozenPoly fp;
+  Poly q;
+  Poly r;
+  bool res = FrozenOpen(buf, len, &fp);
+
+  if (res) {
+    q = FrozenThaw(&fp);
+    r = PolyAt(p, -3);
+    res = PolyIsEq(p, &q) && FrozenIsEq(&fp, p) &&
+          FrozenIsEqFrozen(&fp, &fp) &&
+          FrozenIsCoeff(&fp) == PolyIsCoeff(p) &&
+          FrozenIsZero(&fp) == PolyIsZero(p) &&
+          FrozenDeg(&fp) == PolyDeg(p);
+
+    for (size_t i = 0; i < 4; ++i)
+      res = res && FrozenDegBy(&fp, i) == PolyDegBy(p, i);
+
+    PolyDestroy(&q);
+    q = FrozenAt(&fp, -3);
+    res = res && PolyIsEq(&q, &r);
+    PolyDestroy(&q);
+    PolyDestroy(&r);
+  }
+
+  /* zapisy ucięte są odrzucane */
+  for (size_t i = 0; res && i < len; ++i)
+    res = !FrozenOpen(buf, i, &fp);
+
+  free(buf);
+  return res;
+}
+
+static bool FrozenTest(void)
+{
+  /* p = 5 + x_0^3 x_1 (1 + 2 x_2^2) + LONG_MIN x_0^INT_MAX */
+  Poly p = P(C(5), 0, P(P(C(1), 0, C(2), 2), 1), 3, C(LONG_MIN), INT_MAX);
+  Poly q = P(C(5), 0, P(P(C(1), 0, C(3), 2), 1), 3, C(LONG_MIN), INT_MAX);
+  Poly deep = C(-1);
+  Poly flat = P(C(7), 0, C(-1), 3, C(2), 64);
+  size_t p_len;
+  size_t q_len;
+  unsigned char* p_buf = PolyFreeze(&p, &p_len);
+  unsigned char* q_buf = PolyFreeze(&q, &q_len);
+  FrozenPoly fp;
+  FrozenPoly fq;
+  int32_t* exps;
+  bool res;
+
+  for (int i = 0; i < 1000; ++i)
+    deep = P(deep, i % 3 + 1);
+
+  res = FrozenMatches(&p) && FrozenMatches(&q) && FrozenMatches(&deep) &&
+        FrozenMatches(&flat) &&
+        FrozenMatches(&(Poly) {.coeff = 0, .list = NULL}) &&
+        FrozenMatches(&(Poly) {.coeff = LONG_MAX, .list = NULL});
+
+  res = res && FrozenOpen(p_buf, p_len, &fp) && FrozenOpen(q_buf, q_len, &fq) &&
+        !FrozenIsEqFrozen(&fp, &fq) && !FrozenIsEq(&fp, &q);
+
+  /* zamiana wykładników korzenia łamie ich malejący porządek */
+  exps = (int32_t*)(p_buf + FrozenRoot(&fp)->list + sizeof(uint64_t) +
+                    3 * sizeof(FrozenEntry));
+  exps[0] = 0;
+  exps[2] = INT_MAX;
+  res = res && !FrozenOpen(p_buf, p_len, &fp);
+
+  free(p_buf);
+  free(q_buf);
+  PolyDestroy(&p);
+  PolyDestroy(&q);
+  PolyDestroy(&deep);
+  PolyDestroy(&flat);
+  return res;
+}
+
+/**
+ * Sprawdza, czy kolejne kopie odwzorowanego wielomianu (`CLONE`) pozostają
+ * poprawne, gdy stos rośnie ponad początkowy rozmiar i jego tablice są
+ * realokowane.
+ */
+static bool StackFrozenCloneTest(void)
+{
+  char path[] = "/tmp/poly_test_XXXXXX";
+  int fd = mkstemp(path);
+  Poly p = P(C(1), 0, C(-2), 5, P(C(3), 1), 7);
+  Poly cpy = PolyClone(&p);
+  struct Stack stack = EmptyStack();
+  bool saved = false;
+  bool res = fd >= 0;
+
+  if (res) {
+    close(fd);
+    PushPoly(&stack, &cpy);
+    res = Freeze(&stack, path, &saved) && saved && Pop(&stack) &&
+          Map(&stack, path);
+
+    for (size_t i = 0; res && i < 100; ++i)
+      res = Clone(&stack);
+
+    for (size_t i = 0; res && i < stack.height; ++i) {
+      res = stack.frozen[i].refs == stack.frozen[0].refs &&
+            FrozenIsEq(&stack.frozen[i].fp, &p);
+    }
+
+    res = res && stack.height == 101 && *stack.frozen[0].refs == 101;
+    remove(path);
+  }
+
+  StackDestroy(&stack);
+  PolyDestroy(&p);
+  return res;
+}
+
 /** GRUPY TESTÓW **/
 
 static bool SimpleNegGroup(void)
@@ -4301,6 +5100,24 @@ static const test_list_t test_list[] = {
   TEST(MemoryFreeTest),
   TEST(MemoryGroup),
   TEST(ArrayFunctionsTest),
+  TEST(OwnOpsTest),
+  TEST(GeobucketTest),
+  TEST(DenseMulTest),
+  TEST(TruncTest),
+  TEST(SquareTest),
+  TEST(PowTest),
+  TEST(PowFitsTest),
+  TEST(HashTest),
+  TEST(FingerprintTest),
+  TEST(ProbableTest),
+  TEST(MetaTest),
+  TEST(ShapeTest),
+  TEST(TuningTest),
+  TEST(AtVarTest),
+  TEST(SerializeTest),
+  TEST(FrozenTest),
+  TEST(StackFrozenCloneTest),
+  TEST(ArraySerializeTest),
 };
 
 int main(int argc, char* argv[])
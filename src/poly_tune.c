@@ -0,0 +1,376 @@
+/** @file
+  Kalibracja progów wyboru algorytmów biblioteki (@ref PolyTuning). Program
+  mierzy na syntetycznych wielomianach mnożenie, potęgowanie i składanie
+  każdym z dostępnych algorytmów, wyznacza punkty, w których jeden zaczyna
+  wygrywać z drugim, i zapisuje je jako profil (@ref PolyTuningSave).
+  Kalkulator wczytuje go opcją `--tuning`.
+
+  Użycie: `poly_tune [plik]`; domyślnie profil trafia do `poly.tune`.
+
+  @author Grzegorz Cichosz <g.cichosz@students.mimuw.edu.pl>
+  @copyright Uniwersytet Warszawski
+  @date czerwiec 2021
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <time.h>
+
+#include "poly.h"
+#include "poly_lib.h"
+#include "poly_io.h"
+
+/** Domyślna ścieżka profilu. */
+#define TUNE_DEFAULT_PATH "poly.tune"
+/** Liczba powtórzeń pomiaru; liczy się najszybsze. */
+#define TUNE_REPEATS 3
+/** Czas pojedynczego pomiaru w sekundach, po którym nie mierzymy dalej
+ * większych danych. */
+#define TUNE_TIME_LIMIT 0.5
+/** Liczba jednomianów czynników przy kalibracji mnożenia na tablicy. */
+#define TUNE_DENSE_TERMS 64
+/** Największy badany stosunek rozpiętości do liczby iloczynów. */
+#define TUNE_DENSE_MAX_RATIO 64
+/** Najmniejszy badany wykładnik przy potęgowaniu. */
+#define TUNE_POW_MIN 64
+/** Największy badany wykładnik przy potęgowaniu. */
+#define TUNE_POW_MAX 8192
+/** Odstęp wykładników w potęgowanym rzadkim wielomianie. */
+#define TUNE_POW_GAP 1000
+/** Wykładnik, dla którego porównujemy rozmiary początkowe tablicy. */
+#define TUNE_INIT_EXP 512
+/** Największa liczba jednomianów składanego wielomianu. */
+#define TUNE_COMPOSE_TERMS 8
+/** Ograniczenie wykładników składanego wielomianu. */
+#define TUNE_COMPOSE_EXP 64
+
+/** Rodzaj mierzonego działania. */
+enum TuneOp {
+  TUNE_MUL,                     /**< @ref PolyMul */
+  TUNE_POW,                     /**< @ref PolyPow */
+  TUNE_COMPOSE                  /**< @ref PolyCompose z jednym wielomianem */
+};
+
+/** Stan generatora liczb pseudolosowych (_xorshift_). */
+static uint64_t tune_seed = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * Kolejna liczba pseudolosowa. Ziarno jest stałe, więc każde uruchomienie
+ * mierzy te same wielomiany.
+ * @return liczba pseudolosowa
+ */
+static uint64_t Random(void)
+{
+  tune_seed ^= tune_seed << 13;
+  tune_seed ^= tune_seed >> 7;
+  tune_seed ^= tune_seed << 17;
+  return tune_seed;
+}
+
+/**
+ * Bieżący czas monotoniczny.
+ * @return czas w sekundach
+ */
+static double Now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/**
+ * Rzadki wielomian jednej zmiennej o stałych współczynnikach.
+ * @param[in] terms : liczba losowanych jednomianów
+ * @param[in] spread : wykładniki losowane są z @f$[0, spread)@f$
+ * @return wielomian
+ */
+static Poly SparsePoly(size_t terms, poly_exp_t spread)
+{
+  Mono* monos = malloc(terms * sizeof(Mono));
+  Poly p;
+
+  if (!monos)
+    exit(1);
+
+  for (size_t i = 0; i < terms; ++i) {
+    monos[i] = MonoFromPoly(&(Poly) {.coeff = 1 + Random() % 9, .list = NULL},
+                            Random() % spread);
+  }
+
+  p = PolyAddMonos(terms, monos);
+  free(monos);
+  return p;
+}
+
+/**
+ * Dwumian @f$x_0^{e_0} p_0 + x_0^{e_1} p_1@f$. Przejmuje @p p0 i @p p1 na
+ * własność.
+ * @param[in] p0 : pierwszy współczynnik
+ * @param[in] e0 : pierwszy wykładnik
+ * @param[in] p1 : drugi współczynnik
+ * @param[in] e1 : drugi wykładnik
+ * @return dwumian
+ */
+static Poly Binomial(Poly p0, poly_exp_t e0, Poly p1, poly_exp_t e1)
+{
+  Mono monos[] = {MonoFromPoly(&p0, e0), MonoFromPoly(&p1, e1)};
+
+  return PolyAddMonos(2, monos);
+}
+
+/**
+ * Rzadki wielomian dwu zmiennych @f$x_1 + x_0^{gap}@f$, którego potęgi
+ * pozostają rzadkie.
+ * @return wielomian
+ */
+static Poly SparseBinomial(void)
+{
+  Mono y = MonoFromPoly(&(Poly) {.coeff = 1, .list = NULL}, 1);
+
+  return Binomial(PolyAddMonos(1, &y), 0, PolyFromCoeff(1), TUNE_POW_GAP);
+}
+
+/**
+ * Pomiar działania przy danych progach. Wynik pierwszego powtórzenia jest
+ * zwracany, by można było porównać wyniki różnych algorytmów.
+ * @param[in] t : progi
+ * @param[in] op : działanie
+ * @param[in] p : pierwszy argument
+ * @param[in] q : drugi argument, dla potęgowania pomijany
+ * @param[in] n : wykładnik potęgowania
+ * @param[out] result : wynik działania
+ * @return najkrótszy czas w sekundach
+ */
+static double Measure(const PolyTuning* t, enum TuneOp op, const Poly* p,
+                      const Poly* q, poly_coeff_t n, Poly* result)
+{
+  double best = -1;
+  double start, elapsed;
+  Poly res;
+
+  PolyTuningSet(t);
+
+  for (size_t r = 0; r < TUNE_REPEATS; ++r) {
+    start = Now();
+
+    if (op == TUNE_MUL)
+      res = PolyMul(p, q);
+    else if (op == TUNE_POW)
+      res = PolyPow(p, n);
+    else
+      res = PolyCompose(p, 1, q);
+
+    elapsed = Now() - start;
+
+    if (best < 0 || elapsed < best)
+      best = elapsed;
+
+    if (r == 0)
+      *result = res;
+    else
+      PolyDestroy(&res);
+  }
+
+  return best;
+}
+
+/**
+ * Porównanie tego samego działania przy dwu progach. Różne wyniki oznaczają
+ * błąd biblioteki, więc kończą program.
+ * @param[in] a : pierwsze progi
+ * @param[in] b : drugie progi
+ * @param[in] op : działanie
+ * @param[in] p : pierwszy argument
+ * @param[in] q : drugi argument
+ * @param[in] n : wykładnik potęgowania
+ * @param[out] ta : czas przy progach @p a
+ * @param[out] tb : czas przy progach @p b
+ */
+static void Compare(const PolyTuning* a, const PolyTuning* b, enum TuneOp op,
+                    const Poly* p, const Poly* q, poly_coeff_t n, double* ta,
+                    double* tb)
+{
+  Poly ra, rb;
+  bool same;
+
+  *ta = Measure(a, op, p, q, n, &ra);
+  *tb = Measure(b, op, p, q, n, &rb);
+  same = PolyIsEq(&ra, &rb);
+  PolyDestroy(&ra);
+  PolyDestroy(&rb);
+
+  if (!same) {
+    fprintf(stderr, "poly_tune: algorithms disagree\n");
+    exit(1);
+  }
+}
+
+/**
+ * Kalibracja mnożenia na tablicy: coraz rzadsze czynniki mnożymy na tablicy i
+ * na liście, dopóki tablica wygrywa.
+ * @param[in,out] t : progi, w których ustawiamy @ref PolyTuning::dense_ratio
+ */
+static void TuneDenseRatio(PolyTuning* t)
+{
+  PolyTuning dense = *t;
+  PolyTuning sparse = *t;
+  PolyShape ps, qs;
+  long long ratio;
+  double td, ts;
+  Poly p, q;
+
+  dense.dense_ratio = LLONG_MAX;
+  sparse.dense_ratio = 0;
+  t->dense_ratio = 0;
+
+  for (long long r = 1; r <= TUNE_DENSE_MAX_RATIO; r *= 2) {
+    p = SparsePoly(TUNE_DENSE_TERMS, r * TUNE_DENSE_TERMS * TUNE_DENSE_TERMS);
+    q = SparsePoly(TUNE_DENSE_TERMS, r * TUNE_DENSE_TERMS * TUNE_DENSE_TERMS);
+    PolyShapeOf(&p, 1, &ps);
+    PolyShapeOf(&q, 1, &qs);
+    ratio = ((long long)ps.deg[0] + qs.deg[0] - ps.min - qs.min +
+             ps.terms[0] * qs.terms[0]) / (ps.terms[0] * qs.terms[0]);
+    Compare(&dense, &sparse, TUNE_MUL, &p, &q, 0, &td, &ts);
+    PolyDestroy(&p);
+    PolyDestroy(&q);
+
+    if (td >= ts)
+      break;
+
+    t->dense_ratio = ratio;
+  }
+}
+
+/**
+ * Kalibracja potęgowania: rzadki wielomian dwu zmiennych potęgujemy do coraz
+ * większych wykładników z tablicą iloczynów i bez niej. Próg to ostatni
+ * wykładnik, przy którym tablica jeszcze przegrywa.
+ * @param[in,out] t : progi, w których ustawiamy @ref PolyTuning::big_exp
+ */
+static void TuneBigExp(PolyTuning* t)
+{
+  Poly p = SparseBinomial();
+  PolyTuning big = *t;
+  PolyTuning small = *t;
+  double tb, ts;
+
+  big.big_exp = 0;
+  small.big_exp = LONG_MAX;
+  t->big_exp = 0;
+
+  for (poly_coeff_t n = TUNE_POW_MIN; n <= TUNE_POW_MAX; n *= 2) {
+    Compare(&big, &small, TUNE_POW, &p, NULL, n, &tb, &ts);
+
+    if (tb >= ts)
+      t->big_exp = n;
+
+    if (tb > TUNE_TIME_LIMIT || ts > TUNE_TIME_LIMIT)
+      break;
+  }
+
+  PolyDestroy(&p);
+}
+
+/**
+ * Kalibracja początkowego rozmiaru tablicy iloczynów: wybieramy najszybszy z
+ * kilku.
+ * @param[in,out] t : progi, w których ustawiamy @ref PolyTuning::big_mul_init
+ */
+static void TuneBigMulInit(PolyTuning* t)
+{
+  Poly p = SparseBinomial();
+  PolyTuning trial = *t;
+  double best = -1;
+  double elapsed;
+  Poly res;
+
+  trial.big_exp = 0;
+
+  for (size_t init = 4; init <= 1024; init *= 4) {
+    trial.big_mul_init = init;
+    elapsed = Measure(&trial, TUNE_POW, &p, NULL, TUNE_INIT_EXP, &res);
+    PolyDestroy(&res);
+
+    if (best < 0 || elapsed < best) {
+      best = elapsed;
+      t->big_mul_init = init;
+    }
+  }
+
+  PolyDestroy(&p);
+}
+
+/**
+ * Kalibracja składania: wielomiany o coraz większej liczbie jednomianów
+ * składamy z tablicą potęg i bez niej. Próg to największa przewaga liczby
+ * podniesień do kwadratu, przy której tablica jeszcze przegrywa.
+ * @param[in,out] t : progi, w których ustawiamy @ref PolyTuning::table_bias
+ */
+static void TuneTableBias(PolyTuning* t)
+{
+  Mono y = MonoFromPoly(&(Poly) {.coeff = 1, .list = NULL}, 1);
+  Poly q = Binomial(PolyFromCoeff(1), 1, PolyAddMonos(1, &y), 2);
+  PolyTuning table = *t;
+  PolyTuning direct = *t;
+  long long lowest = LLONG_MAX;
+  long long bias = LLONG_MIN;
+  long long diff;
+  PolyShape shape;
+  double tt, td;
+  Poly p;
+
+  table.table_bias = LLONG_MIN / 2;
+  direct.table_bias = LLONG_MAX / 2;
+
+  for (size_t terms = 1; terms <= TUNE_COMPOSE_TERMS; ++terms) {
+    p = SparsePoly(terms, TUNE_COMPOSE_EXP);
+    PolyShapeOf(&p, 1, &shape);
+    diff = shape.squarings;
+
+    for (poly_exp_t n = shape.deg[0]; n > 1; n /= 2)
+      --diff;
+
+    Compare(&table, &direct, TUNE_COMPOSE, &p, &q, 0, &tt, &td);
+    PolyDestroy(&p);
+
+    if (diff < lowest)
+      lowest = diff;
+
+    if (td < tt && diff > bias)
+      bias = diff;
+  }
+
+  t->table_bias = bias == LLONG_MIN ? lowest - 1 : bias;
+  PolyDestroy(&q);
+}
+
+/**
+ * Kalibracja wszystkich progów i zapis profilu.
+ * @param[in] argc : liczba argumentów
+ * @param[in] argv : argumenty; pierwszy to opcjonalna ścieżka profilu
+ * @return kod wyjścia
+ */
+int main(int argc, char* argv[])
+{
+  const char* path = argc > 1 ? argv[1] : TUNE_DEFAULT_PATH;
+  PolyTuning t = PolyTuningDefault();
+
+  TuneDenseRatio(&t);
+  TuneBigExp(&t);
+  TuneBigMulInit(&t);
+  TuneTableBias(&t);
+  PolyTuningSet(&t);
+
+  printf("dense_ratio %lld\nbig_exp %ld\nbig_mul_init %zu\ntable_bias %lld\n",
+         t.dense_ratio, t.big_exp, t.big_mul_init, t.table_bias);
+
+  if (!PolyTuningSave(&t, path)) {
+    perror(path);
+    return 1;
+  }
+
+  return 0;
+}
@@ -9,9 +9,12 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "poly.h"
 #include "poly_lib.h"
+#include "poly_io.h"
 #include "stack_op.h"
 
 /**
@@ -22,12 +25,275 @@
  * Mnożnik względem którego rozszerza się tablica stosowa. */
 #define ARR_RESIZE 2
 
+/**
+ * Rodzaj komendy liczonej w osobnym wątku. */
+enum JobKind {
+  JOB_MUL,                      /**< `MUL` */
+  JOB_COMPOSE,                  /**< `COMPOSE k` */
+  JOB_AT                        /**< `AT x` */
+};
+
+/**
+ * Komenda liczona w osobnym wątku. Argumenty należą do niej od chwili
+ * uruchomienia, więc wątek nie dzieli z resztą programu żadnej pamięci. */
+struct Job {
+  enum JobKind kind;            /**< rodzaj komendy */
+  Poly* args;                   /**< argumenty w kolejności od dna stosu */
+  size_t k;                     /**< parametr `COMPOSE` */
+  poly_coeff_t x;               /**< parametr `AT` */
+  Poly result;                  /**< wynik */
+  pthread_t worker;             /**< wątek liczący */
+};
+
+/**
+ * Liczba wątków, które liczą komendy i nie zostały jeszcze złączone. */
+static size_t jobs_running;
+
+/**
+ * Poziom przechodzenia wielomianu przy wypisywaniu -- lista jednomianów
+ * odwrócona na czas wypisania i jednomian, na którym jesteśmy. */
+struct PrintFrame {
+  MonoList* rev;                /**< odwrócona lista, od najmniejszego wykładnika */
+  MonoList* node;               /**< bieżący jednomian */
+};
+
+/**
+ * Stos poziomów wypisywania, współdzielony między wywołaniami. */
+static struct PrintFrame* print_frames;
+
+/**
+ * Pojemność stosu poziomów wypisywania. */
+static size_t print_frames_size;
+
+/**
+ * Poziom wypisywania zamrożonego wielomianu -- lista i liczba jej jednomianów
+ * jeszcze do wypisania, od końca. */
+struct FrozenPrintFrame {
+  FrozenList l;                 /**< lista */
+  size_t left;                  /**< liczba niewypisanych jednomianów */
+};
+
+/**
+ * Stos poziomów wypisywania zamrożonych wielomianów. */
+static struct FrozenPrintFrame* frozen_print_frames;
+
+/**
+ * Pojemność stosu poziomów wypisywania zamrożonych wielomianów. */
+static size_t frozen_print_frames_size;
+
+/**
+ * Składnik leniwego wyrażenia. */
+struct LazyTerm {
+  Poly p;                       /**< wielomian */
+  bool neg;                     /**< czy składnik jest odejmowany */
+};
+
+/**
+ * Leniwe wyrażenie: suma składników ze znakami, czekająca na złączenie w
+ * akumulatorze, bądź wynik komendy liczonej w osobnym wątku. Obliczone ma
+ * jeden dodatni składnik -- swoją wartość. Miejsca stosu skopiowane przez
+ * `CLONE` dzielą wyrażenie. */
+struct LazyExpr {
+  size_t refs;                  /**< liczba miejsc stosu z tym wyrażeniem */
+  struct Job* job;              /**< liczona komenda, której wynik będzie
+                                     jedynym składnikiem, bądź `NULL` */
+  struct LazyTerm* terms;       /**< składniki */
+  size_t count;                 /**< liczba składników */
+  size_t size;                  /**< pojemność tablicy składników */
+};
+
+/**
+ * Dopisanie składnika do wyrażenia. Przejmuje wielomian na własność.
+ * @param[in,out] e : wyrażenie
+ * @param[in] p : wielomian
+ * @param[in] neg : czy składnik jest odejmowany
+ */
+static void LazyAppend(struct LazyExpr* e, Poly* p, bool neg)
+{
+  if (e->count == e->size) {
+    e->size = e->size ? e->size * ARR_RESIZE : INIT_STACK_SIZE;
+    e->terms = realloc(e->terms, e->size * sizeof(struct LazyTerm));
+
+    if (!e->terms)
+      exit(1);
+  }
+
+  e->terms[e->count].p = *p;
+  e->terms[e->count++].neg = neg;
+}
+
+/**
+ * Nowe wyrażenie bez składników, należące do jednego miejsca stosu.
+ * @return wyrażenie
+ */
+static struct LazyExpr* LazyNew(void)
+{
+  struct LazyExpr* e = calloc(1, sizeof(struct LazyExpr));
+
+  if (!e)
+    exit(1);
+
+  e->refs = 1;
+  return e;
+}
+
+/**
+ * Policzenie komendy; treść wątku liczącego.
+ * @param[in,out] arg : komenda
+ * @return `NULL`
+ */
+static void* JobRun(void* arg)
+{
+  struct Job* job = arg;
+
+  switch (job->kind) {
+  case JOB_MUL:
+    job->result = PolyMulOwn(job->args + 1, job->args);
+    break;
+  case JOB_COMPOSE:
+    job->result = PolyComposeOwn(job->args + job->k, job->k, job->args);
+    break;
+  case JOB_AT:
+    job->result = PolyAtOwn(job->args, job->x);
+    break;
+  }
+
+  /* Own-owe operacje zostawiają w argumentach same zera */
+  free(job->args);
+  return NULL;
+}
+
+/**
+ * Zaczekanie na wynik komendy liczonej dla wyrażenia, o ile jakaś jest.
+ * @param[in,out] e : wyrażenie
+ */
+static void LazyWait(struct LazyExpr* e)
+{
+  if (!e->job)
+    return;
+
+  pthread_join(e->job->worker, NULL);
+  --jobs_running;
+  LazyAppend(e, &e->job->result, false);
+  free(e->job);
+  e->job = NULL;
+}
+
+/**
+ * Obliczenie wyrażenia -- wszystkie składniki łączone są naraz w
+ * akumulatorze, a odejmowane negowane w miejscu tuż przed włożeniem.
+ * @param[in,out] e : wyrażenie
+ * @return wartość wyrażenia, należąca do niego
+ */
+static Poly* LazyMaterialise(struct LazyExpr* e)
+{
+  Geobucket sum;
+
+  LazyWait(e);
+
+  if (e->count == 1 && !e->terms[0].neg)
+    return &e->terms[0].p;
+
+  GeobucketInit(&sum);
+
+  for (size_t i = 0; i < e->count; ++i) {
+    if (e->terms[i].neg)
+      PolyNegComp(&e->terms[i].p);
+
+    GeobucketInsert(&sum, &e->terms[i].p);
+  }
+
+  e->terms[0].p = GeobucketFinalise(&sum);
+  e->terms[0].neg = false;
+  e->count = 1;
+  return &e->terms[0].p;
+}
+
+/**
+ * Porzucenie wyrażenia przez miejsce stosu. Ostatnie odwołanie je usuwa.
+ * @param[in,out] e : wyrażenie
+ */
+static void LazyRelease(struct LazyExpr* e)
+{
+  if (--e->refs > 0)
+    return;
+
+  LazyWait(e);
+
+  for (size_t i = 0; i < e->count; ++i)
+    PolyDestroy(&e->terms[i].p);
+
+  free(e->terms);
+  free(e);
+}
+
+/**
+ * Przeniesienie składników wyrażenia @p src do @p dst, z odwróceniem znaków,
+ * jeśli @p flip. Wyrażenie dzielone z innymi miejscami stosu zostaje --
+ * przenosimy kopię jego wartości.
+ * @param[in,out] dst : wyrażenie docelowe
+ * @param[in,out] src : porzucane wyrażenie
+ * @param[in] flip : czy odwrócić znaki
+ */
+static void LazyMoveInto(struct LazyExpr* dst, struct LazyExpr* src, bool flip)
+{
+  Poly cpy;
+
+  if (src->refs > 1) {
+    cpy = PolyClone(LazyMaterialise(src));
+    LazyAppend(dst, &cpy, flip);
+    LazyRelease(src);
+    return;
+  }
+
+  LazyWait(src);
+
+  for (size_t i = 0; i < src->count; ++i)
+    LazyAppend(dst, &src->terms[i].p, src->terms[i].neg != flip);
+
+  src->count = 0;
+  LazyRelease(src);
+}
+
+/**
+ * Porzucenie zamrożonego wielomianu z miejsca stosu. Ostatnie odwołanie
+ * zwalnia odwzorowanie pliku.
+ * @param[in,out] sf : miejsce stosu z zamrożonym wielomianem
+ */
+static void Release(struct StackFrozen* sf)
+{
+  if (--*sf->refs == 0) {
+    FrozenUnmap(&sf->fp);
+    free(sf->refs);
+  }
+
+  sf->refs = NULL;
+}
+
 void StackDestroy(struct Stack* stack)
 {
-  for (size_t i = 0; i < stack->height; ++i)
-    PolyDestroy(stack->polys + i);
+  for (size_t i = 0; i < stack->height; ++i) {
+    if (stack->frozen[i].refs)
+      Release(stack->frozen + i);
+    else if (stack->lazy[i])
+      LazyRelease(stack->lazy[i]);
+    else
+      PolyDestroy(stack->polys + i);
+  }
 
   free(stack->polys);
+  free(stack->frozen);
+  free(stack->lazy);
+  free(stack->fingerprints);
+  free(stack->metas);
+
+  /* bufory wypisywania są wspólne, a przy następnym PRINT powstaną od nowa */
+  free(print_frames);
+  print_frames = NULL;
+  print_frames_size = 0;
+  free(frozen_print_frames);
+  frozen_print_frames = NULL;
+  frozen_print_frames_size = 0;
 }
 
 struct Stack EmptyStack()
@@ -37,24 +303,83 @@ struct Stack EmptyStack()
   stack.height = 0;
   stack.size = INIT_STACK_SIZE;
   stack.polys = malloc(stack.size * sizeof(Poly));
-
-  if (!stack.polys)
+  stack.frozen = malloc(stack.size * sizeof(struct StackFrozen));
+  stack.lazy = malloc(stack.size * sizeof(struct LazyExpr*));
+  stack.fingerprints = malloc(stack.size * sizeof(struct StackFingerprint));
+  stack.metas = malloc(stack.size * sizeof(struct StackMeta));
+  stack.lazy_mode = false;
+  stack.jobs = 1;
+  stack.memo = NULL;
+  stack.fingerprint_mode = false;
+
+  if (!stack.polys || !stack.frozen || !stack.lazy || !stack.fingerprints ||
+      !stack.metas)
     exit(1);
 
   return stack;
 }
 
+/**
+ * Zmiana fizycznej wielkości stosu.
+ * @param[in,out] stack : stos
+ * @param[in] size : nowa wielkość
+ */
+static void Resize(struct Stack* stack, size_t size)
+{
+  stack->size = size;
+  stack->polys = realloc(stack->polys, stack->size * sizeof(Poly));
+  stack->frozen = realloc(stack->frozen,
+                          stack->size * sizeof(struct StackFrozen));
+  stack->lazy = realloc(stack->lazy, stack->size * sizeof(struct LazyExpr*));
+  stack->fingerprints = realloc(stack->fingerprints,
+                                stack->size * sizeof(struct StackFingerprint));
+  stack->metas = realloc(stack->metas, stack->size * sizeof(struct StackMeta));
+
+  if (!stack->polys || !stack->frozen || !stack->lazy || !stack->fingerprints ||
+      !stack->metas)
+    exit(1);
+}
+
+/**
+ * Odłożenie wyniku komendy na stos, bez odcisku i metadanych.
+ * @param[in,out] stack : stos
+ * @param[in] p : wielomian
+ */
+static void Push(struct Stack* stack, Poly* p)
+{
+  if (stack->height >= stack->size)
+    Resize(stack, stack->size * ARR_RESIZE);
+
+  stack->frozen[stack->height].refs = NULL;
+  stack->lazy[stack->height] = NULL;
+  stack->fingerprints[stack->height].known = false;
+  stack->metas[stack->height].known = false;
+  stack->polys[stack->height++] = *p;
+}
+
 void PushPoly(struct Stack* stack, Poly* p)
 {
-  if (stack->height >= stack->size) {
-    stack->size *= ARR_RESIZE;
-    stack->polys = realloc(stack->polys, stack->size * sizeof(Poly));
+  Push(stack, p);
 
-    if (!stack->polys)
-      exit(1);
+  if (stack->fingerprint_mode) {
+    stack->fingerprints[stack->height - 1].value = PolyFingerprint(p);
+    stack->fingerprints[stack->height - 1].known = true;
   }
+}
 
-  stack->polys[stack->height++] = *p;
+/**
+ * Odłożenie zamrożonego wielomianu na czubek stosu. Przejmuje odwołanie do
+ * odwzorowania. Miejsce przekazujemy przez wartość, bo może pochodzić z tego
+ * samego stosu, którego tablice @ref Push realokuje.
+ * @param[in,out] stack : stos
+ * @param[in] sf : zamrożony wielomian z licznikiem odwołań
+ */
+static void PushFrozen(struct Stack* stack, struct StackFrozen sf)
+{
+  Poly p = PolyZero();
+
+  Push(stack, &p);
+  stack->frozen[stack->height - 1] = sf;
 }
 
 /**
@@ -99,13 +424,169 @@ static Poly* Cadr(const struct Stack* stack)
 static void Trim(struct Stack* stack)
 {
   if (stack->height >= INIT_STACK_SIZE &&
-      stack->height * ARR_RESIZE * ARR_RESIZE <= stack->size) {
-    stack->size /= ARR_RESIZE;
-    stack->polys = realloc(stack->polys, stack->size * sizeof(Poly));
+      stack->height * ARR_RESIZE * ARR_RESIZE <= stack->size)
+    Resize(stack, stack->size / ARR_RESIZE);
+}
 
-    if (!stack->polys)
-      exit(1);
+/**
+ * Zamrożony wielomian z miejsca stosu o numerze @p i od czubka.
+ * @param[in] stack : stos
+ * @param[in] i : numer miejsca, od zera
+ * @return zamrożony wielomian bądź `NULL`, jeśli leży tam zwykły
+ */
+static const FrozenPoly* Frozen(const struct Stack* stack, size_t i)
+{
+  struct StackFrozen* sf = stack->frozen + stack->height - 1 - i;
+
+  assert(stack->height > i);
+  return sf->refs ? &sf->fp : NULL;
+}
+
+/**
+ * Odcisk wielomianu z miejsca stosu o numerze @p i od czubka.
+ * @param[in] stack : stos
+ * @param[in] i : numer miejsca, od zera
+ * @return odcisk
+ */
+static struct StackFingerprint* FingerprintOf(const struct Stack* stack,
+                                              size_t i)
+{
+  return stack->fingerprints + stack->height - 1 - i;
+}
+
+/**
+ * Metadane wielomianu z miejsca stosu o numerze @p i od czubka.
+ * @param[in] stack : stos
+ * @param[in] i : numer miejsca, od zera
+ * @return metadane
+ */
+static struct StackMeta* MetaOf(const struct Stack* stack, size_t i)
+{
+  return stack->metas + stack->height - 1 - i;
+}
+
+/**
+ * Metadane zwykłego (niezamrożonego) wielomianu z czubka stosu, policzone,
+ * jeśli nie były znane. Leniwe wyrażenie musi być już rozliczone.
+ * @param[in,out] stack : niepusty stos
+ * @return metadane
+ */
+static const PolyMeta* KnownMeta(struct Stack* stack)
+{
+  struct StackMeta* sm = MetaOf(stack, 0);
+
+  if (!sm->known) {
+    sm->meta = PolyMetaOf(Car(stack));
+    sm->known = true;
+  }
+
+  return &sm->meta;
+}
+
+/**
+ * Zastąpienie leniwego wyrażenia z miejsca stosu jego wartością.
+ * @param[in,out] stack : stos
+ * @param[in] j : indeks miejsca od dna
+ */
+static void SettleAt(struct Stack* stack, size_t j)
+{
+  struct LazyExpr* e = stack->lazy[j];
+
+  if (!e)
+    return;
+
+  if (e->refs > 1) {
+    stack->polys[j] = PolyClone(LazyMaterialise(e));
+  } else {
+    stack->polys[j] = *LazyMaterialise(e);
+    e->count = 0;
+  }
+
+  LazyRelease(e);
+  stack->lazy[j] = NULL;
+}
+
+/**
+ * Obliczenie leniwych wyrażeń z @p k miejsc na czubku stosu przed komendą,
+ * która potrzebuje ich wartości. Zamrożone wielomiany zostają zamrożone.
+ * @param[in,out] stack : stos
+ * @param[in] k : liczba miejsc
+ */
+static void Settle(struct Stack* stack, size_t k)
+{
+  for (size_t j = stack->height - k; j < stack->height; ++j)
+    SettleAt(stack, j);
+}
+
+/**
+ * Rozmrożenie zamrożonego wielomianu z miejsca stosu.
+ * @param[in,out] stack : stos
+ * @param[in] j : indeks miejsca od dna
+ */
+static void ThawAt(struct Stack* stack, size_t j)
+{
+  if (stack->frozen[j].refs) {
+    stack->polys[j] = FrozenThaw(&stack->frozen[j].fp);
+    Release(stack->frozen + j);
+  }
+}
+
+/**
+ * Sprowadzenie @p k wielomianów z czubka stosu do zwykłej postaci przed
+ * komendą, która je zmienia: rozmrożenie zamrożonych i obliczenie leniwych.
+ * @param[in,out] stack : stos
+ * @param[in] k : liczba wielomianów
+ */
+static void Thaw(struct Stack* stack, size_t k)
+{
+  for (size_t j = stack->height - k; j < stack->height; ++j) {
+    SettleAt(stack, j);
+    ThawAt(stack, j);
+  }
+}
+
+/**
+ * Leniwe wyrażenie z miejsca stosu o numerze @p i od czubka. Zwykły bądź
+ * zamrożony wielomian staje się wyrażeniem o jednym składniku.
+ * @param[in,out] stack : stos
+ * @param[in] i : numer miejsca, od zera
+ * @return wyrażenie, być może dzielone z innymi miejscami
+ */
+static struct LazyExpr* Lazify(struct Stack* stack, size_t i)
+{
+  size_t j = stack->height - 1 - i;
+
+  if (!stack->lazy[j]) {
+    ThawAt(stack, j);
+    stack->lazy[j] = LazyNew();
+    LazyAppend(stack->lazy[j], stack->polys + j, false);
+    stack->polys[j] = PolyZero();
+  }
+
+  return stack->lazy[j];
+}
+
+/**
+ * Jak @ref Lazify, ale wyrażenie należy tylko do tego miejsca stosu, więc
+ * można je zmieniać.
+ * @param[in,out] stack : stos
+ * @param[in] i : numer miejsca, od zera
+ * @return wyrażenie
+ */
+static struct LazyExpr* LazyOwn(struct Stack* stack, size_t i)
+{
+  struct LazyExpr* e = Lazify(stack, i);
+  struct LazyExpr* own;
+
+  if (e->refs == 1) {
+    LazyWait(e);
+    return e;
   }
+
+  own = LazyNew();
+  LazyMoveInto(own, e, false);
+  stack->lazy[stack->height - 1 - i] = own;
+  return own;
 }
 
 bool Pop(struct Stack* stack)
@@ -113,69 +594,295 @@ bool Pop(struct Stack* stack)
   if (stack->height < 1)
     return false;
 
-  PolyDestroy(Car(stack));
+  if (stack->frozen[stack->height - 1].refs)
+    Release(stack->frozen + stack->height - 1);
+  else if (stack->lazy[stack->height - 1])
+    LazyRelease(stack->lazy[stack->height - 1]);
+  else
+    PolyDestroy(Car(stack));
+
   --stack->height;
   Trim(stack);
   return true;
 }
 
+/**
+ * Uruchomienie komendy na @p n wielomianach z czubka stosu. Argumenty
+ * przechodzą na własność komendy, a na ich miejsce trafia wyrażenie, które
+ * poczeka na wynik, gdy ten będzie potrzebny. Komendy zależne od wyniku
+ * czekają więc na nią, a niezależne wykonują się w tym czasie dalej. Gdy
+ * wolnych wątków nie ma, komenda liczona jest od razu.
+ * @param[in,out] stack : stos
+ * @param[in] n : liczba argumentów
+ * @param[in] job : komenda bez argumentów, zaalokowana
+ */
+static void Launch(struct Stack* stack, size_t n, struct Job* job)
+{
+  struct LazyExpr* e;
+  Poly res;
+
+  Thaw(stack, n);
+  job->args = malloc(n * sizeof(Poly));
+
+  if (!job->args)
+    exit(1);
+
+  for (size_t i = 0; i < n; ++i) {
+    job->args[i] = stack->polys[stack->height - n + i];
+    stack->polys[stack->height - n + i] = PolyZero();
+  }
+
+  /* argumenty należą już do komendy, więc na stosie zostały zera */
+  for (size_t i = 0; i < n; ++i)
+    Pop(stack);
+
+  if (jobs_running + 1 < stack->jobs &&
+      pthread_create(&job->worker, NULL, JobRun, job) == 0) {
+    ++jobs_running;
+    e = LazyNew();
+    e->job = job;
+    res = PolyZero();
+    Push(stack, &res);
+    stack->lazy[stack->height - 1] = e;
+    return;
+  }
+
+  JobRun(job);
+  res = job->result;
+  free(job);
+  Push(stack, &res);
+}
+
+/**
+ * Nowa komenda do uruchomienia przez @ref Launch.
+ * @param[in] kind : rodzaj komendy
+ * @return komenda
+ */
+static struct Job* JobNew(enum JobKind kind)
+{
+  struct Job* job = malloc(sizeof(struct Job));
+
+  if (!job)
+    exit(1);
+
+  job->kind = kind;
+  return job;
+}
+
+/**
+ * Wykonanie komendy na @p n wielomianach z czubka stosu przez pamięć
+ * wyników: zapamiętany wynik jest kopiowany, a nowy zapamiętywany wraz z
+ * argumentami. Komendy na samych współczynnikach są tańsze niż szukanie,
+ * więc je zostawiamy wywołującemu.
+ * @param[in,out] stack : stos
+ * @param[in] op : komenda
+ * @param[in] arg : jej parametr
+ * @param[in] n : liczba argumentów
+ * @return czy komenda została wykonana
+ */
+static bool Memoise(struct Stack* stack, enum MemoOp op, poly_coeff_t arg,
+                    size_t n)
+{
+  Poly* args = stack->polys + stack->height - n;
+  struct MemoKey key;
+  bool trivial = true;
+  Poly res;
+
+  Thaw(stack, n);
+
+  for (size_t i = 0; i < n; ++i)
+    trivial = trivial && PolyIsCoeff(args + i);
+
+  if (trivial)
+    return false;
+
+  MemoKeyInit(&key, op, arg, n, args);
+
+  if (!MemoFind(stack->memo, &key, &res)) {
+    switch (op) {
+    case MEMO_MUL:
+      res = PolyMul(args + 1, args);
+      break;
+    case MEMO_COMPOSE:
+      res = PolyCompose(args + arg, arg, args);
+      break;
+    case MEMO_AT:
+      res = PolyAt(args, arg);
+      break;
+    }
+
+    /* argumenty przechodzą do pamięci, na stosie zostają zera */
+    MemoInsert(stack->memo, &key, &res);
+  }
+
+  for (size_t i = 0; i < n; ++i)
+    Pop(stack);
+
+  Push(stack, &res);
+  return true;
+}
+
+/**
+ * Leniwe dodawanie bądź odejmowanie: składniki obu wyrażeń z czubka stosu
+ * trafiają do jednego wyrażenia, bez liczenia czegokolwiek. Odejmowanie, tak
+ * jak @ref Sub, odejmuje od wierzchołka wielomian pod nim.
+ * @param[in,out] stack : stos z co najmniej dwoma wielomianami
+ * @param[in] sub : czy odejmować
+ */
+static void LazyCombine(struct Stack* stack, bool sub)
+{
+  struct LazyExpr* dst = LazyOwn(stack, sub ? 0 : 1);
+  struct LazyExpr* src = Lazify(stack, sub ? 1 : 0);
+
+  LazyMoveInto(dst, src, sub);
+  stack->lazy[stack->height - 2] = dst;
+  stack->lazy[stack->height - 1] = NULL;
+  Pop(stack);
+}
+
 bool Add(struct Stack* stack)
 {
+  struct StackFingerprint p;
+  struct StackFingerprint q;
+
   if (stack->height < 2)
     return false;
 
-  PolyIncorporate(Cadr(stack), Car(stack));
-  /* Pop niszczy wielomian na czubku, więc podstawiam tam figuranckie 0 */
-  *Car(stack) = PolyZero();
-  Pop(stack);
+  p = *FingerprintOf(stack, 0);
+  q = *FingerprintOf(stack, 1);
+
+  if (stack->lazy_mode) {
+    LazyCombine(stack, false);
+  } else {
+    Thaw(stack, 2);
 
+    /* PolyAddOwn zostawia na czubku figuranckie 0, które Pop bez szkody
+     * niszczy */
+    *Cadr(stack) = PolyAddOwn(Cadr(stack), Car(stack));
+    Pop(stack);
+  }
+
+  FingerprintOf(stack, 0)->known = p.known && q.known;
+  FingerprintOf(stack, 0)->value = p.value + q.value;
+  MetaOf(stack, 0)->known = false;
   return true;
 }
 
 bool Sub(struct Stack* stack)
 {
+  struct StackFingerprint p;
+  struct StackFingerprint q;
+
   if (stack->height < 2)
     return false;
 
-  PolyNegComp(Cadr(stack));
-  return Add(stack);
+  p = *FingerprintOf(stack, 0);
+  q = *FingerprintOf(stack, 1);
+
+  if (stack->lazy_mode) {
+    LazyCombine(stack, true);
+  } else {
+    Thaw(stack, 2);
+    *Cadr(stack) = PolySubOwn(Car(stack), Cadr(stack));
+    Pop(stack);
+  }
+
+  FingerprintOf(stack, 0)->known = p.known && q.known;
+  FingerprintOf(stack, 0)->value = p.value - q.value;
+  MetaOf(stack, 0)->known = false;
+  return true;
 }
 
 bool Mul(struct Stack* stack)
 {
-  Poly new;
+  struct StackFingerprint p;
+  struct StackFingerprint q;
+  struct LazyExpr* e;
+  Poly sq;
 
   if (stack->height < 2)
     return false;
 
-  new = PolyMul(Car(stack), Cadr(stack));
-  Pop(stack);
-  Pop(stack);
-  PushPoly(stack, &new);
+  p = *FingerprintOf(stack, 0);
+  q = *FingerprintOf(stack, 1);
+
+  /* CLONE i MUL to kwadrat -- oba miejsca dzielą wtedy jedno wyrażenie */
+  e = stack->lazy[stack->height - 1];
+
+  if (e && e == stack->lazy[stack->height - 2]) {
+    sq = PolySquare(LazyMaterialise(e));
+    Pop(stack);
+    Pop(stack);
+    Push(stack, &sq);
+  } else if (stack->memo && Memoise(stack, MEMO_MUL, 0, 2)) {
+    /* wynik wzięty z pamięci wyników bądź do niej włożony */
+  } else if (stack->jobs > 1) {
+    Launch(stack, 2, JobNew(JOB_MUL));
+  } else {
+    Thaw(stack, 2);
+    *Cadr(stack) = PolyMulOwn(Car(stack), Cadr(stack));
+    Pop(stack);
+  }
 
+  FingerprintOf(stack, 0)->known = p.known && q.known;
+  FingerprintOf(stack, 0)->value = p.value * q.value;
+  MetaOf(stack, 0)->known = false;
   return true;
 }
 
 bool Clone(struct Stack* stack)
 {
+  struct StackFingerprint p;
+  struct StackMeta meta;
+  struct LazyExpr* e;
   Poly cpy;
 
   if (stack->height < 1)
     return false;
 
-  cpy = PolyClone(Car(stack));
-  PushPoly(stack, &cpy);
+  p = *FingerprintOf(stack, 0);
+  meta = *MetaOf(stack, 0);
+
+  if (Frozen(stack, 0)) {
+    /* kopia zamrożonego wielomianu to tylko kolejne odwołanie do zapisu */
+    ++*stack->frozen[stack->height - 1].refs;
+    PushFrozen(stack, stack->frozen[stack->height - 1]);
+  } else if (stack->lazy_mode) {
+    /* w trybie leniwym kopia dzieli wyrażenie z oryginałem */
+    e = Lazify(stack, 0);
+    ++e->refs;
+    cpy = PolyZero();
+    Push(stack, &cpy);
+    stack->lazy[stack->height - 1] = e;
+  } else {
+    Settle(stack, 1);
+    cpy = PolyClone(Car(stack));
+    Push(stack, &cpy);
+  }
 
+  *FingerprintOf(stack, 0) = p;
+  *MetaOf(stack, 0) = meta;
   return true;
 }
 
 bool Neg(struct Stack* stack)
 {
+  struct LazyExpr* e;
+
   if (stack->height < 1)
     return false;
 
-  PolyNegComp(Car(stack));
+  if (stack->lazy_mode) {
+    e = LazyOwn(stack, 0);
 
+    for (size_t i = 0; i < e->count; ++i)
+      e->terms[i].neg = !e->terms[i].neg;
+  } else {
+    Thaw(stack, 1);
+    *Car(stack) = PolyNegOwn(Car(stack));
+  }
+
+  FingerprintOf(stack, 0)->value = -FingerprintOf(stack, 0)->value;
   return true;
 }
 
@@ -190,142 +897,657 @@ static void Predicate(bool p)
   else printf("0\n");
 }
 
-bool IsCoeff(const struct Stack* stack)
+bool IsCoeff(struct Stack* stack)
 {
   if (stack->height < 1)
     return false;
 
-  Predicate(PolyIsCoeff(Car(stack)));
+  Settle(stack, 1);
+  if (Frozen(stack, 0))
+    Predicate(FrozenIsCoeff(Frozen(stack, 0)));
+  else
+    Predicate(PolyIsCoeff(Car(stack)));
 
   return true;
 }
 
-bool IsZero(const struct Stack* stack)
+bool IsZero(struct Stack* stack)
 {
   if (stack->height < 1)
     return false;
 
-  Predicate(PolyIsZero(Car(stack)));
+  Settle(stack, 1);
+  if (Frozen(stack, 0))
+    Predicate(FrozenIsZero(Frozen(stack, 0)));
+  else
+    Predicate(PolyIsZero(Car(stack)));
+
+  return true;
+}
+
+bool IsEq(struct Stack* stack)
+{
+  const FrozenPoly* fp;
+  const FrozenPoly* fq;
+
+  if (stack->height < 2)
+    return false;
+
+  Settle(stack, 2);
+  fp = Frozen(stack, 0);
+  fq = Frozen(stack, 1);
+
+  /* odciski liczymy raz, a różne od razu rozstrzygają nierówność */
+  for (size_t i = 0; i < 2 && stack->fingerprint_mode; ++i) {
+    if (!FingerprintOf(stack, i)->known && !Frozen(stack, i)) {
+      FingerprintOf(stack, i)->value =
+        PolyFingerprint(stack->polys + stack->height - 1 - i);
+      FingerprintOf(stack, i)->known = true;
+    }
+  }
+
+  if (FingerprintOf(stack, 0)->known && FingerprintOf(stack, 1)->known &&
+      FingerprintOf(stack, 0)->value != FingerprintOf(stack, 1)->value)
+    Predicate(false);
+  else if (fp && fq)
+    Predicate(FrozenIsEqFrozen(fp, fq));
+  else if (fp)
+    Predicate(FrozenIsEq(fp, Cadr(stack)));
+  else if (fq)
+    Predicate(FrozenIsEq(fq, Car(stack)));
+  else
+    Predicate(PolyIsEq(Car(stack), Cadr(stack)));
 
   return true;
 }
 
-bool IsEq(const struct Stack* stack)
+bool IsEqFast(struct Stack* stack)
 {
+  double error;
+
   if (stack->height < 2)
     return false;
 
-  Predicate(PolyIsEq(Car(stack), Cadr(stack)));
+  Settle(stack, 2);
+
+  if (Frozen(stack, 0) || Frozen(stack, 1))
+    return IsEq(stack);
+
+  if (FingerprintOf(stack, 0)->known && FingerprintOf(stack, 1)->known &&
+      FingerprintOf(stack, 0)->value != FingerprintOf(stack, 1)->value)
+    Predicate(false);
+  else
+    Predicate(PolyIsEqProbable(Car(stack), Cadr(stack), &error));
 
   return true;
 }
 
-bool Deg(const struct Stack* stack)
+bool Deg(struct Stack* stack)
 {
   if (stack->height < 1)
     return false;
 
-  printf("%d\n", PolyDeg(Car(stack)));
+  Settle(stack, 1);
+  if (Frozen(stack, 0))
+    printf("%d\n", FrozenDeg(Frozen(stack, 0)));
+  else
+    printf("%d\n", KnownMeta(stack)->deg);
 
   return true;
 }
 
-bool DegBy(const struct Stack* stack, unsigned long long idx)
+bool DegBy(struct Stack* stack, unsigned long long idx)
 {
   if (stack->height < 1)
     return false;
 
-  printf("%d\n", PolyDegBy(Car(stack), idx));
+  Settle(stack, 1);
+  if (Frozen(stack, 0))
+    printf("%d\n", FrozenDegBy(Frozen(stack, 0), idx));
+  else if (MetaOf(stack, 0)->known && idx >= MetaOf(stack, 0)->meta.depth)
+    /* wielomian nie zależy od tej zmiennej; metadanych nie liczymy tylko po
+     * to, bo ich wyliczenie kosztuje tyle co samo PolyDegBy */
+    printf("%d\n", PolyIsZero(Car(stack)) ? -1 : 0);
+  else
+    printf("%d\n", PolyDegBy(Car(stack), idx));
   return true;
 }
 
 bool At(struct Stack* stack, poly_coeff_t x)
 {
+  struct Job* job;
   Poly new;
 
   if (stack->height < 1)
     return false;
 
-  new = PolyAt(Car(stack), x);
-  Pop(stack);
-  PushPoly(stack, &new);
+  FingerprintOf(stack, 0)->known = false;
+  MetaOf(stack, 0)->known = false;
+
+  if (stack->memo && Memoise(stack, MEMO_AT, x, 1))
+    return true;
+
+  if (stack->jobs > 1 && !Frozen(stack, 0)) {
+    job = JobNew(JOB_AT);
+    job->x = x;
+    Launch(stack, 1, job);
+    return true;
+  }
+
+  Settle(stack, 1);
+
+  if (Frozen(stack, 0)) {
+    new = FrozenAt(Frozen(stack, 0), x);
+    Release(stack->frozen + stack->height - 1);
+    *Car(stack) = new;
+    return true;
+  }
+
+  *Car(stack) = PolyAtOwn(Car(stack), x);
+  return true;
+}
+
+bool AtVar(struct Stack* stack, size_t idx, poly_coeff_t x)
+{
+  if (stack->height < 1)
+    return false;
+
+  Thaw(stack, 1);
+  *Car(stack) = PolyAtVarOwn(Car(stack), idx, x);
+  FingerprintOf(stack, 0)->known = false;
+  MetaOf(stack, 0)->known = false;
   return true;
 }
 
 bool Compose(struct Stack* stack, size_t k)
 {
+  struct Job* job;
   Poly composee;
 
   /* druga część jest tutaj celem bronienia się przed k = ULONG_MAX */
   if (stack->height < k + 1 || k + 1 < 1)
     return false;
 
-  composee = PolyCompose(Car(stack), k, stack->polys + stack->height - k - 1);
+  if (stack->memo && Memoise(stack, MEMO_COMPOSE, k, k + 1))
+    return true;
+
+  if (stack->jobs > 1) {
+    job = JobNew(JOB_COMPOSE);
+    job->k = k;
+    Launch(stack, k + 1, job);
+    return true;
+  }
+
+  Thaw(stack, k + 1);
 
+  composee = PolyComposeOwn(Car(stack), k,
+                            stack->polys + stack->height - k - 1);
+
+  /* na stosie zostały same zera po przejętych wielomianach */
   for (size_t i = 0; i <= k; ++i)
     Pop(stack);
 
-  PushPoly(stack, &composee);
+  Push(stack, &composee);
+  return true;
+}
+
+bool MulTrunc(struct Stack* stack, poly_exp_t deg)
+{
+  Poly new;
+
+  if (stack->height < 2)
+    return false;
+
+  Thaw(stack, 2);
+  new = PolyMulTrunc(Car(stack), Cadr(stack), deg);
+  Pop(stack);
+  PolyDestroy(Car(stack));
+  *Car(stack) = new;
+  FingerprintOf(stack, 0)->known = false;
+  MetaOf(stack, 0)->known = false;
+
+  return true;
+}
+
+bool Trunc(struct Stack* stack, poly_exp_t deg)
+{
+  Poly new;
+
+  if (stack->height < 1)
+    return false;
+
+  Thaw(stack, 1);
+  new = PolyTrunc(Car(stack), deg);
+  PolyDestroy(Car(stack));
+  *Car(stack) = new;
+  FingerprintOf(stack, 0)->known = false;
+  MetaOf(stack, 0)->known = false;
+
+  return true;
+}
+
+bool Pow(struct Stack* stack, poly_coeff_t n, bool* fits)
+{
+  Poly new;
+
+  if (stack->height < 1)
+    return false;
+
+  Thaw(stack, 1);
+  *fits = PolyPowFits(Car(stack), n);
+
+  if (!*fits)
+    return true;
+
+  new = n == 2 ? PolySquare(Car(stack)) : PolyPow(Car(stack), n);
+  PolyDestroy(Car(stack));
+  *Car(stack) = new;
+  FingerprintOf(stack, 0)->value =
+    FingerprintPow(FingerprintOf(stack, 0)->value, n);
+  MetaOf(stack, 0)->known = false;
+
   return true;
 }
 
-static void PrintPoly(const Poly* p);
+/**
+ * Rozmiar bufora, w którym składamy wypisywane wielomiany. */
+#define OUT_BUF_SIZE (1 << 16)
+
+/**
+ * Ile miejsca w buforze może zająć jeden jednomian bez wnętrza: `+(`,
+ * współczynnik, przecinek, wykładnik i `)`. */
+#define OUT_MONO_SIZE 48
+
+/**
+ * Bufor wyjścia. Wypełniony oddajemy `fwrite`owi, więc kolejność względem
+ * pozostałych `printf`ów jest zachowana. */
+static char out_buf[OUT_BUF_SIZE];
+
+/**
+ * Zajęta część bufora wyjścia. */
+static size_t out_len;
+
+/**
+ * Oddanie zawartości bufora na standardowe wyjście. */
+static void OutFlush(void)
+{
+  fwrite(out_buf, 1, out_len, stdout);
+  out_len = 0;
+}
 
 /**
- * Wypisanie jednomianu.
- * @param[in] m : jednomian
+ * Zapewnienie miejsca na @p n znaków w buforze wyjścia.
+ * @param[in] n : liczba znaków
  */
-static void PrintMono(const Mono* m)
+static void OutReserve(size_t n)
 {
-  printf("(");
-  PrintPoly(&(m->p));
-  printf(",%d)", m->exp);
+  if (out_len + n > OUT_BUF_SIZE)
+    OutFlush();
 }
 
 /**
- * Wypisanie od tyłu (albowiem trzymane są one w kolejności malejącej, a żąda
- * się od nas wypisania ich w wykładnikami rosnąco) listy jednomianów. Ze
- * względu  na tę odtylniość jest to robione schematem rekurencyjnego wybrania
- * się na sam koniec listy, by następnie stopniowo wracać i dopiero wypisywać.
- * Jednomiany są rozdzielone plusami.
- * @param[in] ml : lista jednomianów
+ * Dopisanie znaku do bufora wyjścia. Miejsce musi być zarezerwowane.
+ * @param[in] c : znak
  */
-static void PrintMonoList(MonoList* ml)
+static void OutChar(char c)
 {
-  if (!ml)
-    return;
+  out_buf[out_len++] = c;
+}
 
-  PrintMonoList(ml->tail);
+/**
+ * Dopisanie liczby dziesiętnie do bufora wyjścia. Cyfry wypisujemy parami z
+ * tablicy, od końca. Miejsce musi być zarezerwowane.
+ * @param[in] v : liczba
+ */
+static void OutLong(long v)
+{
+  static const char pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+  char tmp[24];
+  char* p = tmp + sizeof(tmp);
+  unsigned long u = v < 0 ? 0UL - (unsigned long)v : (unsigned long)v;
+
+  while (u >= 100) {
+    p -= 2;
+    memcpy(p, pairs + u % 100 * 2, 2);
+    u /= 100;
+  }
 
-  /* przed pierwszym jednomianem nie ma plusa */
-  if (!ml->tail) {
-    PrintMono(&ml->m);
+  if (u >= 10) {
+    p -= 2;
+    memcpy(p, pairs + u * 2, 2);
   } else {
-    printf("+");
-    PrintMono(&ml->m);
+    *--p = '0' + u;
   }
+
+  if (v < 0)
+    *--p = '-';
+
+  memcpy(out_buf + out_len, p, tmp + sizeof(tmp) - p);
+  out_len += tmp + sizeof(tmp) - p;
 }
 
 /**
- * Wypisanie w kolejności rosnących wykładników wielomianu @p p.
- * @param[in] p : wielomian
+ * Odwrócenie listy jednomianów w miejscu.
+ * @param[in] ml : lista
+ * @return głowa odwróconej listy
  */
-static void PrintPoly(const Poly* p)
+static MonoList* MonoListReverse(MonoList* ml)
 {
-  if (PolyIsCoeff(p))
-    printf("%ld", p->coeff);
-  else
-    PrintMonoList(p->list);
+  MonoList* rev = NULL;
+  MonoList* next;
+
+  while (ml) {
+    next = ml->tail;
+    ml->tail = rev;
+    rev = ml;
+    ml = next;
+  }
+
+  return rev;
+}
+
+/**
+ * Wejście na nowy poziom wypisywania.
+ * @param[in] depth : liczba poziomów na stosie
+ * @param[in,out] ml : lista jednomianów poziomu
+ */
+static void PrintFramePush(size_t depth, MonoList* ml)
+{
+  if (depth == print_frames_size) {
+    print_frames_size = print_frames_size ? print_frames_size * ARR_RESIZE
+                                          : INIT_STACK_SIZE;
+    print_frames = realloc(print_frames,
+                           print_frames_size * sizeof(struct PrintFrame));
+
+    if (!print_frames)
+      exit(1);
+  }
+
+  print_frames[depth].rev = MonoListReverse(ml);
+  print_frames[depth].node = print_frames[depth].rev;
+}
+
+/**
+ * Wypisanie w kolejności rosnących wykładników wielomianu @p p. Listy trzymane
+ * są malejąco, więc na czas wypisania każdą odwracamy w miejscu, a po
+ * wypisaniu przywracamy. Zagnieżdżenia obsługuje jawny stos zamiast rekurencji.
+ * W trakcie wypisywania @p p nie jest poprawnym wielomianem, więc nikt inny
+ * nie może go wtedy czytać.
+ * @param[in,out] p : wielomian, po powrocie taki sam jak przed wywołaniem
+ */
+static void PrintPoly(Poly* p)
+{
+  struct PrintFrame* f;
+  size_t depth = 0;
+
+  OutReserve(OUT_MONO_SIZE);
+
+  if (PolyIsCoeff(p)) {
+    OutLong(p->coeff);
+    return;
+  }
+
+  PrintFramePush(depth++, p->list);
+
+  while (depth > 0) {
+    f = print_frames + depth - 1;
+
+    if (!f->node) {
+      MonoListReverse(f->rev);
+
+      if (--depth > 0) {
+        f = print_frames + depth - 1;
+        OutReserve(OUT_MONO_SIZE);
+        OutChar(',');
+        OutLong(f->node->m.exp);
+        OutChar(')');
+        f->node = f->node->tail;
+      }
+
+      continue;
+    }
+
+    OutReserve(OUT_MONO_SIZE);
+
+    if (f->node != f->rev)
+      OutChar('+');
+
+    OutChar('(');
+
+    if (PolyIsCoeff(&f->node->m.p)) {
+      OutLong(f->node->m.p.coeff);
+      OutChar(',');
+      OutLong(f->node->m.exp);
+      OutChar(')');
+      f->node = f->node->tail;
+    } else {
+      PrintFramePush(depth++, f->node->m.p.list);
+    }
+  }
+}
+
+/**
+ * Wejście na nowy poziom wypisywania zamrożonego wielomianu.
+ * @param[in] depth : liczba poziomów na stosie
+ * @param[in] l : lista jednomianów poziomu
+ */
+static void FrozenPrintFramePush(size_t depth, FrozenList l)
+{
+  if (depth == frozen_print_frames_size) {
+    frozen_print_frames_size = frozen_print_frames_size
+                               ? frozen_print_frames_size * ARR_RESIZE
+                               : INIT_STACK_SIZE;
+    frozen_print_frames =
+      realloc(frozen_print_frames,
+              frozen_print_frames_size * sizeof(struct FrozenPrintFrame));
+
+    if (!frozen_print_frames)
+      exit(1);
+  }
+
+  frozen_print_frames[depth].l = l;
+  frozen_print_frames[depth].left = l.count;
+}
+
+/**
+ * Wypisanie zamrożonego wielomianu @p fp, jak @ref PrintPoly. Listy zapisu
+ * są tablicami, więc wystarcza przechodzić je od końca.
+ * @param[in] fp : zamrożony wielomian
+ */
+static void PrintFrozen(const FrozenPoly* fp)
+{
+  const FrozenEntry* e = FrozenRoot(fp);
+  struct FrozenPrintFrame* f;
+  size_t depth = 0;
+
+  OutReserve(OUT_MONO_SIZE);
+
+  if (FrozenEntryIsCoeff(e)) {
+    OutLong(e->coeff);
+    return;
+  }
+
+  FrozenPrintFramePush(depth++, FrozenGetList(fp, e));
+
+  while (depth > 0) {
+    f = frozen_print_frames + depth - 1;
+
+    if (f->left == 0) {
+      if (--depth > 0) {
+        f = frozen_print_frames + depth - 1;
+        OutReserve(OUT_MONO_SIZE);
+        OutChar(',');
+        OutLong(f->l.exps[--f->left]);
+        OutChar(')');
+      }
+
+      continue;
+    }
+
+    OutReserve(OUT_MONO_SIZE);
+
+    if (f->left != f->l.count)
+      OutChar('+');
+
+    OutChar('(');
+    e = f->l.coeffs + f->left - 1;
+
+    if (FrozenEntryIsCoeff(e)) {
+      OutLong(e->coeff);
+      OutChar(',');
+      OutLong(f->l.exps[--f->left]);
+      OutChar(')');
+    } else {
+      FrozenPrintFramePush(depth++, FrozenGetList(fp, e));
+    }
+  }
 }
 
-bool Print(const struct Stack* stack)
+bool Print(struct Stack* stack)
 {
   if (stack->height < 1) {
     return false;
   }
 
-  PrintPoly(Car(stack));
-  printf("\n");
+  Settle(stack, 1);
+
+  if (Frozen(stack, 0))
+    PrintFrozen(Frozen(stack, 0));
+  else
+    PrintPoly(Car(stack));
+  OutReserve(1);
+  OutChar('\n');
+  OutFlush();
+
+  return true;
+}
+
+/**
+ * Zapis wielomianu z czubka niepustego stosu funkcją @p save. Zamrożony
+ * wielomian na czas zapisu rozmrażamy.
+ * @param[in] stack : stos
+ * @param[in] path : ścieżka pliku
+ * @param[in] save : funkcja zapisu
+ * @return czy udało się zapisać plik
+ */
+static bool SaveWith(const struct Stack* stack, const char* path,
+                     bool (*save)(const Poly*, const char*))
+{
+  Poly p;
+  bool ok;
+
+  if (!Frozen(stack, 0))
+    return save(Car(stack), path);
+
+  p = FrozenThaw(Frozen(stack, 0));
+  ok = save(&p, path);
+  PolyDestroy(&p);
+  return ok;
+}
+
+bool Save(struct Stack* stack, const char* path, bool* saved)
+{
+  if (stack->height < 1)
+    return false;
+
+  Settle(stack, 1);
+  *saved = SaveWith(stack, path, PolySave);
+  return true;
+}
+
+bool Load(struct Stack* stack, const char* path)
+{
+  Poly p;
+
+  if (!PolyLoad(path, &p))
+    return false;
+
+  PushPoly(stack, &p);
+  return true;
+}
+
+bool Freeze(struct Stack* stack, const char* path, bool* saved)
+{
+  if (stack->height < 1)
+    return false;
+
+  Settle(stack, 1);
+  *saved = SaveWith(stack, path, PolyFreezeSave);
+  return true;
+}
+
+bool Map(struct Stack* stack, const char* path)
+{
+  struct StackFrozen sf;
+
+  if (!FrozenMap(path, &sf.fp))
+    return false;
+
+  sf.refs = malloc(sizeof(size_t));
+
+  if (!sf.refs)
+    exit(1);
+
+  *sf.refs = 1;
+  PushFrozen(stack, sf);
+  return true;
+}
+
+bool Checkpoint(struct Stack* stack, const char* path)
+{
+  Poly* polys = malloc((stack->height ? stack->height : 1) * sizeof(Poly));
+  bool ok;
+
+  if (!polys)
+    exit(1);
+
+  Settle(stack, stack->height);
+
+  /* zwykłe wielomiany zapisujemy wprost, a zamrożone na czas zapisu
+   * rozmrażamy */
+  for (size_t i = 0; i < stack->height; ++i) {
+    if (stack->frozen[i].refs)
+      polys[i] = FrozenThaw(&stack->frozen[i].fp);
+    else
+      polys[i] = stack->polys[i];
+  }
+
+  ok = PolyArraySave(stack->height, polys, path);
+
+  for (size_t i = 0; i < stack->height; ++i) {
+    if (stack->frozen[i].refs)
+      PolyDestroy(polys + i);
+  }
+
+  free(polys);
+  return ok;
+}
+
+bool Restore(struct Stack* stack, const char* path)
+{
+  bool lazy_mode = stack->lazy_mode;
+  size_t jobs = stack->jobs;
+  struct Memo* memo = stack->memo;
+  bool fingerprint_mode = stack->fingerprint_mode;
+  Poly* polys;
+  size_t count;
+
+  if (!PolyArrayLoad(path, &count, &polys))
+    return false;
+
+  StackDestroy(stack);
+  *stack = EmptyStack();
+  stack->lazy_mode = lazy_mode;
+  stack->jobs = jobs;
+  stack->memo = memo;
+  stack->fingerprint_mode = fingerprint_mode;
+
+  for (size_t i = 0; i < count; ++i)
+    PushPoly(stack, polys + i);
 
+  free(polys);
   return true;
 }
@@ -10,13 +10,65 @@
 #define _STACK_OP_H_
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "poly.h"
+#include "poly_lib.h"
+#include "poly_io.h"
+#include "memo.h"
+
+/**
+ * Zamrożony wielomian na stosie. Wielomiany z jednego odwzorowanego pliku
+ * dzielą licznik odwołań; ostatni zwalnia odwzorowanie. */
+struct StackFrozen {
+  FrozenPoly fp;                /**< zamrożony wielomian */
+  size_t* refs;                 /**< licznik odwołań do odwzorowania bądź
+                                     `NULL`, jeśli na tym miejscu stosu leży
+                                     zwykły wielomian */
+};
+
+struct LazyExpr;
+
+/**
+ * Odcisk wielomianu z miejsca stosu (@ref PolyFingerprint). Komendy
+ * pierścieniowe wyliczają odcisk wyniku z odcisków argumentów, a pozostałe
+ * go zapominają. */
+struct StackFingerprint {
+  uint64_t value;               /**< odcisk */
+  bool known;                   /**< czy odcisk jest znany */
+};
+
+/**
+ * Metadane wielomianu z miejsca stosu (@ref PolyMetaOf), liczone przy
+ * pierwszej potrzebie. `CLONE` i `NEG` je zachowują, a pozostałe komendy
+ * zmieniające wielomian zapominają. */
+struct StackMeta {
+  PolyMeta meta;                /**< metadane */
+  bool known;                   /**< czy metadane są znane */
+};
 
 /**
  * Stos z wielomianami. */
 struct Stack {
   Poly* polys;                  /**< tablica wielomianów złożonych na stosie */
+  struct StackFrozen* frozen;   /**< tablica równoległa do @p polys z
+                                     wielomianami zamrożonymi */
+  struct LazyExpr** lazy;       /**< tablica równoległa do @p polys z leniwymi
+                                     wyrażeniami bądź `NULL` */
+  bool lazy_mode;               /**< czy `ADD`, `SUB`, `NEG` i `CLONE`
+                                     odkładają wyrażenia zamiast liczyć */
+  size_t jobs;                  /**< ile komend `MUL`, `COMPOSE` i `AT` może
+                                     liczyć się naraz, wliczając bieżący
+                                     wątek; 1 to liczenie po kolei */
+  struct Memo* memo;            /**< pamięć wyników `MUL`, `COMPOSE` i `AT`
+                                     bądź `NULL`; nie należy do stosu */
+  struct StackFingerprint* fingerprints; /**< tablica równoległa do @p polys
+                                              z odciskami */
+  bool fingerprint_mode;        /**< czy liczyć odciski wczytanych
+                                     wielomianów, by `IS_EQ` mogło od razu
+                                     rozstrzygać nierówność */
+  struct StackMeta* metas;      /**< tablica równoległa do @p polys ze
+                                     stopniami i rozmiarami */
   size_t height;                /**< obecna wysokość stosu */
   size_t size;                  /**< fizyczna wielkość tablicy w pamięci */
 };
@@ -92,41 +144,51 @@ static inline void Zero(struct Stack* stack)
 /**
  * Sprawdzian czy wielomian z czubka stosu to wielomian stały. W razie
  * zaistnienia takiej sytuacji na wyjście wypisywana jest jedynka; wpp. zero.
- * @param[in] stack : stos kalkulacyjny
+ * @param[in,out] stack : stos kalkulacyjny
  * @return czy nie nastąpiło niedopełnienie stosu @p stack
  */
-bool IsCoeff(const struct Stack* stack);
+bool IsCoeff(struct Stack* stack);
 
 /**
  * Sprawdzian czy wielomian z czubka stosu to wielomian zerowy. W razie
  * zaistnienia takiej sytuacji na wyjście wypisywana jest jedynka; wpp. zero.
- * @param[in] stack : stos kalkulacyjny
+ * @param[in,out] stack : stos kalkulacyjny
  * @return czy nie nastąpiło niedopełnienie stosu @p stack
  */
-bool IsZero(const struct Stack* stack);
+bool IsZero(struct Stack* stack);
 
 /**
  * Sprawdzian czy dwa wielomiany z czubka stosu są równe. W razie
  * zaistnienia takiej sytuacji na wyjście wypisywana jest jedynka; wpp. zero.
- * @param[in] stack : stos kalkulacyjny
+ * @param[in,out] stack : stos kalkulacyjny
+ * @return czy nie nastąpiło niedopełnienie stosu @p stack
+ */
+bool IsEq(struct Stack* stack);
+
+/**
+ * Jak @ref IsEq, ale równość sprawdzana jest probabilistycznie przez
+ * @ref PolyIsEqProbable. Jedynka może być błędna z prawdopodobieństwem
+ * ograniczonym przez tę funkcję; zero jest zawsze prawdziwe. Zamrożone
+ * wielomiany porównywane są dokładnie, bo ich porównanie i tak jest szybkie.
+ * @param[in,out] stack : stos kalkulacyjny
  * @return czy nie nastąpiło niedopełnienie stosu @p stack
  */
-bool IsEq(const struct Stack* stack);
+bool IsEqFast(struct Stack* stack);
 
 /**
  * Podanie stopnia wielomianu z czubka stosu (wypisuje się go na standardowe
  * wyjście).
- * @param[in] stack : stos kalkulacyjny
+ * @param[in,out] stack : stos kalkulacyjny
  * @return czy nie nastąpiło niedopełnienie stosu @p stack
  */
-bool Deg(const struct Stack* stack);
+bool Deg(struct Stack* stack);
 
 /**
  * Wypisanie wielomianu z czubka stosy
- * @param[in] stack : stos kalkulacyjny
+ * @param[in,out] stack : stos kalkulacyjny
  * @return czy nie nastąpiło niedopełnienie stosu @p stack
  */
-bool Print(const struct Stack* stack);
+bool Print(struct Stack* stack);
 
 /**
  * Usunięcie wielomianu z czubka stosu.
@@ -140,11 +202,11 @@ bool Pop(struct Stack* stack);
 /**
  * Wypisanie stopnia wielomianu z czubka @p stack względem zmiennej spod indeksu
  * @p idx.
- * @param[in] stack : stos kalkulacyjny
+ * @param[in,out] stack : stos kalkulacyjny
  * @param[in] idx : indeks zmiennej
  * @return czy nie nastąpiło niedopełnienie stosu @p stack
  */
-bool DegBy(const struct Stack* stack, unsigned long long idx);
+bool DegBy(struct Stack* stack, unsigned long long idx);
 
 /**
  * Podstawienie do wielomianu z czubka @p stack pod główną zmienną wartości
@@ -155,6 +217,17 @@ bool DegBy(const struct Stack* stack, unsigned long long idx);
  */
 bool At(struct Stack* stack, poly_coeff_t x);
 
+/**
+ * Podstawienie do wielomianu z czubka @p stack wartości @p x pod zmienną
+ * o indeksie @p idx i podmianka tego pierwotnego wielomianu na ten po
+ * podstawieniu.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] idx : indeks zmiennej
+ * @param[in] x : wartość do podstawienia
+ * @return czy nie nastąpiło niedopełnienie stosu @p stack
+ */
+bool AtVar(struct Stack* stack, size_t idx, poly_coeff_t x);
+
 /**
  * Podstawienie @p k najwyższych wielomianów ze @p stack pod główną odpowiednie
  * zmienne i podmianka tych pierwotnych wielomianów na ten po podstawieniu.
@@ -164,4 +237,89 @@ bool At(struct Stack* stack, poly_coeff_t x);
  */
 bool Compose(struct Stack* stack, size_t k);
 
+/**
+ * Pomnożenie dwóch wielomianów ze szczytu stosu @p stack z pominięciem
+ * jednomianów stopnia większego niż @p deg i odłożenie na ich miejsce tegoż
+ * obciętego iloczynu.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] deg : ograniczenie stopnia
+ * @return czy nie nastąpiło niedopełnienie stosu @p stack
+ */
+bool MulTrunc(struct Stack* stack, poly_exp_t deg);
+
+/**
+ * Obcięcie wielomianu z czubka stosu @p stack do stopnia @p deg.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] deg : ograniczenie stopnia
+ * @return czy nie nastąpiło niedopełnienie stosu @p stack
+ */
+bool Trunc(struct Stack* stack, poly_exp_t deg);
+
+/**
+ * Podniesienie wielomianu z czubka stosu @p stack do potęgi @p n. Gdy
+ * wykładniki wyniku nie mieszczą się w @ref poly_exp_t (@ref PolyPowFits),
+ * stos pozostaje bez zmian.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] n : wykładnik, nieujemny
+ * @param[out] fits : czy wykładniki potęgi mieszczą się w zakresie
+ * @return czy nie nastąpiło niedopełnienie stosu @p stack
+ */
+bool Pow(struct Stack* stack, poly_coeff_t n, bool* fits);
+
+/**
+ * Zapis binarny wielomianu z czubka stosu @p stack do pliku @p path. Stos
+ * pozostaje bez zmian.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] path : ścieżka pliku
+ * @param[out] saved : czy udało się zapisać plik
+ * @return czy nie nastąpiło niedopełnienie stosu @p stack
+ */
+bool Save(struct Stack* stack, const char* path, bool* saved);
+
+/**
+ * Wczytanie wielomianu z pliku z zapisem binarnym i odłożenie go na stos.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się wczytać poprawny zapis
+ */
+bool Load(struct Stack* stack, const char* path);
+
+/**
+ * Zapis zamrożony wielomianu z czubka stosu @p stack do pliku @p path. Stos
+ * pozostaje bez zmian.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] path : ścieżka pliku
+ * @param[out] saved : czy udało się zapisać plik
+ * @return czy nie nastąpiło niedopełnienie stosu @p stack
+ */
+bool Freeze(struct Stack* stack, const char* path, bool* saved);
+
+/**
+ * Odwzorowanie w pamięci pliku z zapisem zamrożonym i odłożenie wielomianu na
+ * stos bez rozmrażania. Komendy tylko czytające wielomian liczą wprost na
+ * zapisie, a zmieniające go najpierw go rozmrażają.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się odwzorować poprawny zapis
+ */
+bool Map(struct Stack* stack, const char* path);
+
+/**
+ * Zapis całego stosu @p stack do pliku @p path jednym zapisem binarnym.
+ * Stos pozostaje bez zmian.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się zapisać plik
+ */
+bool Checkpoint(struct Stack* stack, const char* path);
+
+/**
+ * Zastąpienie całego stosu @p stack stosem zapisanym przez @ref Checkpoint.
+ * W razie błędu stos pozostaje bez zmian.
+ * @param[in,out] stack : stos kalkulacyjny
+ * @param[in] path : ścieżka pliku
+ * @return czy udało się wczytać poprawny zapis
+ */
+bool Restore(struct Stack* stack, const char* path);
+
 #endif  /* _STACK_OP_H_ */